@@ -1,5 +1,5 @@
-
-
-if(BOOST_ROOT)
+if(Boost_FOUND)
 	target_link_libraries(${PROJECT_NAME} ${Boost_LIBRARIES})
-endif(BOOST_ROOT)
\ No newline at end of file
+endif(Boost_FOUND)
+
+target_link_libraries(${PROJECT_NAME} ${CMAKE_THREAD_LIBS_INIT})
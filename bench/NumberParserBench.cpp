@@ -0,0 +1,145 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the benchmark: ParseDouble against atof
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+// C++ Standard Libraries
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "src/NumberParser.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace
+{
+// what the number loops give back, the two must be identical
+struct ParseResult
+{
+    size_t lineCount = 0;
+    double sum = 0.0;
+};
+
+// lineCount lines of "x y" as XYZ2Im writes them, half of the points fall inside a 6000x4000 image
+string MakeXyz2ImText(size_t lineCount)
+{
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<double> xDistribution(-6000.0, 12000.0);
+    std::uniform_real_distribution<double> yDistribution(-4000.0, 8000.0);
+    string text;
+    char line[64];
+    for(size_t index = 0; lineCount != index; ++index)
+    {
+        const int length = snprintf(line, sizeof(line), "%f %f\n",
+                                    xDistribution(generator), yDistribution(generator));
+        text.append(line, length);
+    }
+    return text;
+}
+
+ParseResult ParseWithParseDouble(const string &text)
+{
+    ParseResult result;
+    const char *line = text.data();
+    const char* const textEnd = line+text.size();
+    while(textEnd != line)
+    {
+        const char *lineEnd = static_cast<const char*>(memchr(line, '\n', textEnd-line));
+        if(nullptr == lineEnd)
+        {
+            lineEnd = textEnd;
+        }
+        const char *space = static_cast<const char*>(memchr(line, ' ', lineEnd-line));
+        if(nullptr != space)
+        {
+            double x = 0.0;
+            double y = 0.0;
+            ParseDouble(line, lineEnd, &x);
+            ParseDouble(space+1, lineEnd, &y);
+            result.sum += x+y;
+            ++result.lineCount;
+        }
+        line = textEnd == lineEnd ? lineEnd : lineEnd+1;
+    }
+    return result;
+}
+
+// text is zero terminated, so atof stops at the end of the number as before
+ParseResult ParseWithAtof(const string &text)
+{
+    ParseResult result;
+    const char *line = text.c_str();
+    const char* const textEnd = line+text.size();
+    while(textEnd != line)
+    {
+        const char *lineEnd = static_cast<const char*>(memchr(line, '\n', textEnd-line));
+        if(nullptr == lineEnd)
+        {
+            lineEnd = textEnd;
+        }
+        const char *space = static_cast<const char*>(memchr(line, ' ', lineEnd-line));
+        if(nullptr != space)
+        {
+            result.sum += atof(line)+atof(space+1);
+            ++result.lineCount;
+        }
+        line = textEnd == lineEnd ? lineEnd : lineEnd+1;
+    }
+    return result;
+}
+
+// the fastest of repeatCount runs of parse, in milliseconds
+template<typename Parse>
+double TimeParse(const string &text, unsigned repeatCount, Parse parse, ParseResult *result)
+{
+    double bestTime = 0.0;
+    for(unsigned repeat = 0; repeatCount != repeat; ++repeat)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        *result = parse(text);
+        const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now()-start;
+        if(0 == repeat || time.count() < bestTime)
+        {
+            bestTime = time.count();
+        }
+    }
+    return bestTime;
+}
+}
+
+// usage: NumberParserBench [lineCount=1000000] [repeatCount=5]
+int main(int argc, char **argv)
+{
+    const size_t lineCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    const unsigned repeatCount = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 5;
+    if(0 == lineCount || 0 == repeatCount)
+    {
+        cout<<endl<<"usage: NumberParserBench [lineCount] [repeatCount]"<<endl;
+        return 1;
+    }
+    const string text = MakeXyz2ImText(lineCount);
+    ParseResult parseDoubleResult;
+    ParseResult atofResult;
+    const double parseDoubleTime = TimeParse(text, repeatCount, ParseWithParseDouble, &parseDoubleResult);
+    const double atofTime = TimeParse(text, repeatCount, ParseWithAtof, &atofResult);
+    cout<<lineCount<<" lines, "<<text.size()<<" bytes, best of "<<repeatCount<<" runs"<<endl;
+    cout<<"ParseDouble: "<<parseDoubleTime<<" ms"<<endl;
+    cout<<"atof:        "<<atofTime<<" ms"<<endl;
+    if(parseDoubleResult.lineCount != atofResult.lineCount || parseDoubleResult.sum != atofResult.sum)
+    {
+        cout<<endl<<"ParseDouble and atof read different numbers"<<endl;
+        return 1;
+    }
+    return 0;
+}
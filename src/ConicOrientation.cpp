@@ -0,0 +1,451 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the structure: ConicOrientation
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ConicOrientation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include "rapidxml.hpp"
+#include "Console.h"
+#include "FileContent.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::shared_ptr;
+
+using boost::filesystem::path;
+
+using rapidxml::xml_document;
+using rapidxml::xml_node;
+
+namespace
+{
+void PrintError(const string &filePath, const char *message)
+{
+    // the workers read their orientations at the same time
+    std::lock_guard<std::mutex> lock(ConsoleMutex());
+    cout<<"Invalid orientation file "<<filePath<<": "<<message<<endl;
+}
+
+// fill values with the count numbers of node, "x y z" -> {x, y, z}
+bool ReadNumbers(const xml_node<> *node, double *values, size_t count)
+{
+    if(nullptr == node)
+    {
+        return false;
+    }
+    const string text(node->value(), node->value()+node->value_size());
+    const char *begin = text.c_str();
+    for(size_t index = 0; count != index; ++index)
+    {
+        char *end = nullptr;
+        values[index] = strtod(begin, &end);
+        if(end == begin)
+        {
+            return false;
+        }
+        begin = end;
+    }
+    return true;
+}
+
+// OrientationConique may be the root or the child of ExportAPERO
+const xml_node<>* FindRoot(const xml_document<> &document, const char *name)
+{
+    const xml_node<> *root = document.first_node(name);
+    if(nullptr != root)
+    {
+        return root;
+    }
+    const xml_node<> *exportApero = document.first_node("ExportAPERO");
+    return nullptr == exportApero ? nullptr : exportApero->first_node(name);
+}
+
+bool ReadRadialPart(const xml_node<> *radial, CameraCalibration *calibration)
+{
+    if(false == ReadNumbers(radial->first_node("CDist"), calibration->distortionCentre, 2))
+    {
+        calibration->error = "cannot find CDist";
+        return false;
+    }
+    size_t &coeffCount = calibration->radialCoeffCount;
+    coeffCount = 0;
+    for(const xml_node<> *coeff = radial->first_node("CoeffDist");
+        nullptr != coeff; coeff = coeff->next_sibling("CoeffDist"))
+    {
+        if(sizeof(calibration->radialCoeffs)/sizeof(double) == coeffCount)
+        {
+            calibration->error = "too many CoeffDist";
+            return false;
+        }
+        if(false == ReadNumbers(coeff, calibration->radialCoeffs+coeffCount, 1))
+        {
+            calibration->error = "invalid CoeffDist";
+            return false;
+        }
+        ++coeffCount;
+    }
+    return true;
+}
+
+bool ReadDistortion(const xml_node<> *calibrationNode, CameraCalibration *calibration)
+{
+    calibration->distortionModel = DistortionModel::None;
+    calibration->radialCoeffCount = 0;
+    calibration->p1 = calibration->p2 = calibration->b1 = calibration->b2 = 0.0;
+    const xml_node<> *knownConv = calibrationNode->first_node("KnownConv");
+    if(nullptr != knownConv &&
+       string(knownConv->value(), knownConv->value_size()) != "eConvApero_DistM2C")
+    {
+        calibration->error = "only eConvApero_DistM2C is supported";
+        return false;
+    }
+    bool found = false;
+    for(const xml_node<> *calibDistortion = calibrationNode->first_node("CalibDistortion");
+        nullptr != calibDistortion; calibDistortion = calibDistortion->next_sibling("CalibDistortion"))
+    {
+        const xml_node<> *model = calibDistortion->first_node();
+        if(nullptr == model || 0 == strcmp(model->name(), "ModNoDist"))
+        {
+            continue;
+        }
+        if(found)
+        {
+            // mm3d chains them, not supported here
+            calibration->error = "several distortion models";
+            return false;
+        }
+        found = true;
+        if(0 == strcmp(model->name(), "ModRad"))
+        {
+            calibration->distortionModel = DistortionModel::Radial;
+            if(false == ReadRadialPart(model, calibration))
+            {
+                return false;
+            }
+        }
+        else if(0 == strcmp(model->name(), "ModPhgrStd"))
+        {
+            calibration->distortionModel = DistortionModel::PhotogrammetricStd;
+            const xml_node<> *radial = model->first_node("RadialePart");
+            if(nullptr == radial)
+            {
+                calibration->error = "cannot find RadialePart";
+                return false;
+            }
+            if(false == ReadRadialPart(radial, calibration))
+            {
+                return false;
+            }
+            // absent terms are zero
+            double *terms[] = {&calibration->p1, &calibration->p2, &calibration->b1, &calibration->b2};
+            const char *termNames[] = {"P1", "P2", "b1", "b2"};
+            for(size_t index = 0; 4 != index; ++index)
+            {
+                const xml_node<> *term = model->first_node(termNames[index]);
+                if(nullptr != term && false == ReadNumbers(term, terms[index], 1))
+                {
+                    calibration->error = "invalid ModPhgrStd term";
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            calibration->error = "unsupported distortion model, use Engine=mm3d";
+            return false;
+        }
+    }
+    return true;
+}
+
+// the problems are recorded in calibration->error, SzIm is read first
+// so that it is known even for a calibration the projection cannot use
+void ReadCalibration(const xml_node<> *calibrationNode, CameraCalibration *calibration)
+{
+    calibration->imageSize[0] = calibration->imageSize[1] = 0;
+    double imageSize[2] = {0.0, 0.0};
+    if(ReadNumbers(calibrationNode->first_node("SzIm"), imageSize, 2))
+    {
+        calibration->imageSize[0] = static_cast<size_t>(imageSize[0]);
+        calibration->imageSize[1] = static_cast<size_t>(imageSize[1]);
+    }
+    if(false == ReadNumbers(calibrationNode->first_node("F"), &calibration->focal, 1))
+    {
+        calibration->error = "cannot find F";
+        return;
+    }
+    if(false == ReadNumbers(calibrationNode->first_node("PP"), calibration->principalPoint, 2))
+    {
+        calibration->error = "cannot find PP";
+        return;
+    }
+    ReadDistortion(calibrationNode, calibration);
+}
+
+// parsed Orientation-*.xml, the content must live as long as the document
+struct OrientationDocument
+{
+    vector<char> content;
+    xml_document<> xml;
+    const xml_node<> *conic;
+};
+
+// errors are printed
+bool ParseOrientation(const string &oriFilePath, OrientationDocument *document)
+{
+    if(false == ReadWholeFile(oriFilePath, &document->content))
+    {
+        PrintError(oriFilePath, "cannot open");
+        return false;
+    }
+    // rapidxml parses a zero terminated string in place
+    document->content.push_back('\0');
+    try
+    {
+        document->xml.parse<rapidxml::parse_no_utf8>(document->content.data());
+    }
+    catch(const rapidxml::parse_error &error)
+    {
+        PrintError(oriFilePath, error.what());
+        return false;
+    }
+    document->conic = FindRoot(document->xml, "OrientationConique");
+    if(nullptr == document->conic)
+    {
+        PrintError(oriFilePath, "cannot find OrientationConique");
+        return false;
+    }
+    return true;
+}
+
+// calibration of an orientation: its Interne, or the shared one of FileInterne
+// calibFilePath names where it comes from, errors of the orientation are printed
+shared_ptr<const CameraCalibration> GetCalibration(const xml_node<> *conic,
+                                                   const string &oriFilePath,
+                                                   const string &datasetRoot,
+                                                   CalibrationCache *calibrationCache,
+                                                   string *calibFilePath)
+{
+    const xml_node<> *interne = conic->first_node("Interne");
+    if(nullptr != interne)
+    {
+        *calibFilePath = oriFilePath;
+        std::shared_ptr<CameraCalibration> calibration(new CameraCalibration());
+        ReadCalibration(interne, calibration.get());
+        return calibration;
+    }
+    const xml_node<> *fileInterne = conic->first_node("FileInterne");
+    if(nullptr == fileInterne)
+    {
+        PrintError(oriFilePath, "cannot find Interne or FileInterne");
+        return nullptr;
+    }
+    path calibPath(string(fileInterne->value(), fileInterne->value()+fileInterne->value_size()));
+    if(calibPath.is_relative())
+    {
+        calibPath = path(datasetRoot)/calibPath;
+    }
+    *calibFilePath = calibPath.string();
+    return calibrationCache->Get(*calibFilePath);
+}
+}
+
+shared_ptr<const CameraCalibration> CalibrationCache::Get(const string &calibFilePath)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto calibIter = m_calibrations.find(calibFilePath);
+        if(m_calibrations.end() != calibIter)
+        {
+            return calibIter->second;
+        }
+    }
+    // parse outside the lock, if two workers meet the same new file
+    // both parse it and the first one is kept
+    std::shared_ptr<CameraCalibration> calibration;
+    vector<char> content;
+    if(false == ReadWholeFile(calibFilePath, &content))
+    {
+        PrintError(calibFilePath, "cannot open calibration");
+    }
+    else
+    {
+        content.push_back('\0');
+        try
+        {
+            xml_document<> calibXml;
+            calibXml.parse<rapidxml::parse_no_utf8>(content.data());
+            const xml_node<> *calibrationNode = FindRoot(calibXml, "CalibrationInternConique");
+            if(nullptr == calibrationNode)
+            {
+                PrintError(calibFilePath, "cannot find CalibrationInternConique");
+            }
+            else
+            {
+                calibration.reset(new CameraCalibration());
+                ReadCalibration(calibrationNode, calibration.get());
+            }
+        }
+        catch(const rapidxml::parse_error &error)
+        {
+            PrintError(calibFilePath, error.what());
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // a failure is kept too, so it is reported once
+    return m_calibrations.insert(std::make_pair(calibFilePath, calibration)).first->second;
+}
+
+bool ReadConicOrientation(const string &oriFilePath, const string &datasetRoot,
+                          CalibrationCache *calibrationCache,
+                          ConicOrientation *orientation)
+{
+    OrientationDocument document;
+    if(false == ParseOrientation(oriFilePath, &document))
+    {
+        return false;
+    }
+    const xml_node<> *conic = document.conic;
+    const xml_node<> *typeProj = conic->first_node("TypeProj");
+    if(nullptr != typeProj && string(typeProj->value(), typeProj->value_size()) != "eProjStenope")
+    {
+        PrintError(oriFilePath, "only eProjStenope is supported");
+        return false;
+    }
+
+    double *i00 = orientation->i00, *v10 = orientation->v10, *v01 = orientation->v01;
+    i00[0] = 0.0; i00[1] = 0.0;
+    v10[0] = 1.0; v10[1] = 0.0;
+    v01[0] = 0.0; v01[1] = 1.0;
+    const xml_node<> *affine = conic->first_node("OrIntImaM2C");
+    if(nullptr != affine && (false == ReadNumbers(affine->first_node("I00"), i00, 2) ||
+                             false == ReadNumbers(affine->first_node("V10"), v10, 2) ||
+                             false == ReadNumbers(affine->first_node("V01"), v01, 2)))
+    {
+        PrintError(oriFilePath, "invalid OrIntImaM2C");
+        return false;
+    }
+
+    const xml_node<> *externe = conic->first_node("Externe");
+    if(nullptr == externe ||
+       false == ReadNumbers(externe->first_node("Centre"), orientation->centre, 3))
+    {
+        PrintError(oriFilePath, "cannot find Externe/Centre");
+        return false;
+    }
+    const xml_node<> *paramRotation = externe->first_node("ParamRotation");
+    const xml_node<> *codageMatr = nullptr == paramRotation ? nullptr :
+                                   paramRotation->first_node("CodageMatr");
+    if(nullptr == codageMatr ||
+       false == ReadNumbers(codageMatr->first_node("L1"), orientation->rotation, 3) ||
+       false == ReadNumbers(codageMatr->first_node("L2"), orientation->rotation+3, 3) ||
+       false == ReadNumbers(codageMatr->first_node("L3"), orientation->rotation+6, 3))
+    {
+        PrintError(oriFilePath, "cannot find ParamRotation/CodageMatr");
+        return false;
+    }
+
+    string calibFilePath;
+    const shared_ptr<const CameraCalibration> calibration =
+        GetCalibration(conic, oriFilePath, datasetRoot, calibrationCache, &calibFilePath);
+    if(nullptr == calibration)
+    {
+        return false;
+    }
+    if(false == calibration->error.empty())
+    {
+        PrintError(calibFilePath, calibration->error.c_str());
+        return false;
+    }
+    orientation->calibration = *calibration;
+    return true;
+}
+
+bool ReadOrientationImageSize(const string &oriFilePath, const string &datasetRoot,
+                              CalibrationCache *calibrationCache,
+                              size_t *width, size_t *height)
+{
+    OrientationDocument document;
+    if(false == ParseOrientation(oriFilePath, &document))
+    {
+        return false;
+    }
+    string calibFilePath;
+    const shared_ptr<const CameraCalibration> calibration =
+        GetCalibration(document.conic, oriFilePath, datasetRoot, calibrationCache, &calibFilePath);
+    if(nullptr == calibration || 0 == calibration->imageSize[0] || 0 == calibration->imageSize[1])
+    {
+        return false;
+    }
+    *width = calibration->imageSize[0];
+    *height = calibration->imageSize[1];
+    return true;
+}
+
+void FindPointsInImage(const ConicOrientation &orientation,
+                       const GroundPointTable &table,
+                       double width, double height,
+                       vector<uint32_t> *insideIndices)
+{
+    // camera = transpose(rotation)*(ground-centre), the table is relative
+    // to its origin: camera = transpose(rotation)*local+transpose(rotation)*(origin-centre)
+    // the constant part is computed in double before going to float
+    const CameraCalibration &calibration = orientation.calibration;
+    CameraConstants camera;
+    const double *rotation = orientation.rotation;
+    double offset[3];
+    for(size_t axis = 0; 3 != axis; ++axis)
+    {
+        offset[axis] = table.origin[axis]-orientation.centre[axis];
+    }
+    for(size_t row = 0; 3 != row; ++row)
+    {
+        camera.rotation[3*row] = static_cast<float>(rotation[row]);
+        camera.rotation[3*row+1] = static_cast<float>(rotation[3+row]);
+        camera.rotation[3*row+2] = static_cast<float>(rotation[6+row]);
+        camera.translation[row] = static_cast<float>(rotation[row]*offset[0]+
+                                                     rotation[3+row]*offset[1]+
+                                                     rotation[6+row]*offset[2]);
+    }
+    camera.focal = static_cast<float>(calibration.focal);
+    camera.principalPoint[0] = static_cast<float>(calibration.principalPoint[0]);
+    camera.principalPoint[1] = static_cast<float>(calibration.principalPoint[1]);
+    camera.distortionModel = static_cast<int>(calibration.distortionModel);
+    camera.distortionCentre[0] = static_cast<float>(calibration.distortionCentre[0]);
+    camera.distortionCentre[1] = static_cast<float>(calibration.distortionCentre[1]);
+    camera.radialCoeffCount = calibration.radialCoeffCount;
+    for(size_t index = 0; calibration.radialCoeffCount != index; ++index)
+    {
+        camera.radialCoeffs[index] = static_cast<float>(calibration.radialCoeffs[index]);
+    }
+    camera.p1 = static_cast<float>(calibration.p1);
+    camera.p2 = static_cast<float>(calibration.p2);
+    camera.b1 = static_cast<float>(calibration.b1);
+    camera.b2 = static_cast<float>(calibration.b2);
+    for(size_t axis = 0; 2 != axis; ++axis)
+    {
+        camera.i00[axis] = static_cast<float>(orientation.i00[axis]);
+        camera.v10[axis] = static_cast<float>(orientation.v10[axis]);
+        camera.v01[axis] = static_cast<float>(orientation.v01[axis]);
+    }
+    camera.width = static_cast<float>(width);
+    camera.height = static_cast<float>(height);
+
+    insideIndices->resize(table.x.size());
+    insideIndices->resize(FindGroundPointsInImage(camera, table, insideIndices->data()));
+}
@@ -0,0 +1,107 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the structure: ConicOrientation
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_CONICORIENTATION_H_
+#define COMMON_CONICORIENTATION_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "ProjectionKernel.h"
+
+// lens distortion models of a CalibDistortion block (eConvApero_DistM2C)
+// the values are the ones of CameraConstants::distortionModel
+enum class DistortionModel
+{
+    // ModNoDist or no CalibDistortion at all
+    None = 0,
+    // ModRad: odd radial polynomial
+    Radial = 1,
+    // ModPhgrStd: RadialePart + decentric P1 P2 + affine b1 b2
+    PhotogrammetricStd = 2
+};
+
+// internal calibration, CalibrationInternConique (the file of FileInterne)
+// or Interne, one calibration is usually shared by many images
+struct CameraCalibration
+{
+    double focal;
+    double principalPoint[2];
+    // SzIm, 0 when the calibration does not record it
+    size_t imageSize[2];
+    // distortion applied to the ideal image position
+    DistortionModel distortionModel;
+    // CDist
+    double distortionCentre[2];
+    // CoeffDist: r^2, r^4, r^6 ... factors of the radial displacement
+    double radialCoeffs[8];
+    size_t radialCoeffCount;
+    // ModPhgrStd only
+    double p1, p2, b1, b2;
+    // why the calibration cannot be used for a native projection,
+    // empty when it can (imageSize may be known either way)
+    std::string error;
+};
+
+// the part of a MicMac OrientationConique (Orientation-*.xml) that
+// XYZ2Im needs to project a ground point, pinhole model (eProjStenope)
+struct ConicOrientation
+{
+    // Externe/Centre
+    double centre[3];
+    // Externe/ParamRotation/CodageMatr, rows L1 L2 L3,
+    // camera to ground: ground = rotation*camera + centre
+    double rotation[9];
+    // OrIntImaM2C: image = i00 + v10*x + v01*y
+    double i00[2];
+    double v10[2];
+    double v01[2];
+    CameraCalibration calibration;
+};
+
+// parses every calibration file once, the workers share it
+class CalibrationCache
+{
+public:
+    // calibration of calibFilePath, nullptr when the file cannot be read
+    std::shared_ptr<const CameraCalibration> Get(const std::string &calibFilePath);
+
+private:
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<const CameraCalibration>> m_calibrations;
+};
+
+// read oriFilePath, a relative FileInterne is resolved against datasetRoot
+// as mm3d does, errors are printed on the console
+bool ReadConicOrientation(const std::string &oriFilePath,
+                          const std::string &datasetRoot,
+                          CalibrationCache *calibrationCache,
+                          ConicOrientation *orientation);
+
+// SzIm of the calibration of oriFilePath, without the rest of the orientation
+// returns false when the calibration does not record it
+bool ReadOrientationImageSize(const std::string &oriFilePath,
+                              const std::string &datasetRoot,
+                              CalibrationCache *calibrationCache,
+                              size_t *width, size_t *height);
+
+// fill insideIndices with the indices of the points of table that are
+// in front of the camera and project into [0,width]x[0,height]
+// the kernel is specialised for the distortion model and vectorised
+void FindPointsInImage(const ConicOrientation &orientation,
+                       const GroundPointTable &table,
+                       double width, double height,
+                       std::vector<uint32_t> *insideIndices);
+
+#endif // COMMON_CONICORIENTATION_H_
@@ -0,0 +1,16 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ConsoleMutex
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "Console.h"
+
+std::mutex &ConsoleMutex()
+{
+    static std::mutex consoleMutex;
+    return consoleMutex;
+}
@@ -0,0 +1,19 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ConsoleMutex
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_CONSOLE_H_
+#define COMMON_CONSOLE_H_
+
+#include <mutex>
+
+// held by whoever prints from a worker thread, one for the whole program
+// so the lines of the workers do not interleave
+std::mutex &ConsoleMutex();
+
+#endif // COMMON_CONSOLE_H_
@@ -0,0 +1,178 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ScanDirectory
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "DirectoryScanner.h"
+
+#include <boost/predef/os.h>
+
+#if BOOST_OS_LINUX != 0
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#else
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+#endif
+
+using std::string;
+using std::vector;
+using std::function;
+
+#if BOOST_OS_LINUX != 0
+namespace
+{
+// a large buffer: one getdents64 call per round trip to an NFS server
+constexpr size_t g_direntBufferSize = 256*1024;
+
+// the kernel record of getdents64, glibc only declares it since 2.30
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// the stat of a regular file as the size cache keys it
+void SetFileKey(const struct stat &fileStat, FileKey *key)
+{
+    key->fileSize = static_cast<uint64_t>(fileStat.st_size);
+    key->mtimeSeconds = static_cast<int64_t>(fileStat.st_mtim.tv_sec);
+    key->mtimeNanoseconds = static_cast<int64_t>(fileStat.st_mtim.tv_nsec);
+    key->inode = static_cast<uint64_t>(fileStat.st_ino);
+}
+}
+
+bool ScanDirectory(const string &directoryPath, const function<bool(const string&)> &nameFilter,
+                   vector<DirectoryEntry> *entries, vector<string> *subdirectories)
+{
+    entries->clear();
+    if(nullptr != subdirectories)
+    {
+        subdirectories->clear();
+    }
+    const int directoryFd = open(directoryPath.empty() ? "." : directoryPath.c_str(),
+                                 O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if(-1 == directoryFd)
+    {
+        return false;
+    }
+    vector<char> buffer(g_direntBufferSize);
+    DirectoryEntry entry;
+    struct stat fileStat;
+    bool succeeded = true;
+    while(true)
+    {
+        const long byteRead = syscall(SYS_getdents64, directoryFd, buffer.data(), buffer.size());
+        if(byteRead <= 0)
+        {
+            succeeded = 0 == byteRead;
+            break;
+        }
+        for(long offset = 0; offset < byteRead;)
+        {
+            const LinuxDirent64 *dirent = reinterpret_cast<const LinuxDirent64*>(buffer.data()+offset);
+            offset += dirent->d_reclen;
+            unsigned char type = dirent->d_type;
+            entry.keyKnown = false;
+            if(DT_UNKNOWN == type && nullptr != subdirectories)
+            {
+                // a directory is only known as such by its stat
+                if(0 != fstatat(directoryFd, dirent->d_name, &fileStat, AT_SYMLINK_NOFOLLOW))
+                {
+                    continue;
+                }
+                type = S_ISDIR(fileStat.st_mode) ? DT_DIR :
+                       S_ISLNK(fileStat.st_mode) ? DT_LNK :
+                       S_ISREG(fileStat.st_mode) ? DT_REG : DT_FIFO;
+                entry.keyKnown = DT_REG == type;
+            }
+            if(DT_DIR == type)
+            {
+                if(nullptr != subdirectories && 0 != strcmp(".", dirent->d_name) &&
+                   0 != strcmp("..", dirent->d_name))
+                {
+                    subdirectories->emplace_back(dirent->d_name);
+                }
+                continue;
+            }
+            if(DT_REG != type && DT_LNK != type && DT_UNKNOWN != type)
+            {
+                continue;
+            }
+            entry.name.assign(dirent->d_name);
+            if(false == nameFilter(entry.name))
+            {
+                continue;
+            }
+            if(DT_REG != type)
+            {
+                if(0 != fstatat(directoryFd, dirent->d_name, &fileStat, 0) ||
+                   false == S_ISREG(fileStat.st_mode))
+                {
+                    continue;
+                }
+                entry.keyKnown = true;
+            }
+            if(entry.keyKnown)
+            {
+                SetFileKey(fileStat, &entry.key);
+            }
+            entries->push_back(entry);
+        }
+    }
+    close(directoryFd);
+    return succeeded;
+}
+#else
+bool ScanDirectory(const string &directoryPath, const function<bool(const string&)> &nameFilter,
+                   vector<DirectoryEntry> *entries, vector<string> *subdirectories)
+{
+    entries->clear();
+    if(nullptr != subdirectories)
+    {
+        subdirectories->clear();
+    }
+    boost::system::error_code errorCode;
+    boost::filesystem::directory_iterator iter(boost::filesystem::path(directoryPath), errorCode), end;
+    if(errorCode)
+    {
+        return false;
+    }
+    DirectoryEntry entry;
+    for(; end != iter; iter.increment(errorCode))
+    {
+        if(errorCode)
+        {
+            return false;
+        }
+        entry.name = iter->path().filename().string();
+        if(boost::filesystem::is_directory(iter->symlink_status()))
+        {
+            if(nullptr != subdirectories)
+            {
+                subdirectories->push_back(entry.name);
+            }
+            continue;
+        }
+        if(false == nameFilter(entry.name) || false == boost::filesystem::is_regular_file(*iter))
+        {
+            continue;
+        }
+        entry.keyKnown = false;
+        entries->push_back(entry);
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,41 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ScanDirectory
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_DIRECTORYSCANNER_H_
+#define COMMON_DIRECTORYSCANNER_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "FileKey.h"
+
+// a regular file found by ScanDirectory
+struct DirectoryEntry
+{
+    std::string name;
+    // the file had to be stat'ed to know its type, key is its stat
+    bool keyKnown;
+    FileKey key;
+};
+
+// the regular files of directoryPath (symbolic links followed) whose name
+// nameFilter accepts, in no particular order, false when it cannot be read
+// on Linux the directory is read with getdents64 and the type comes from
+// d_type, a file is only stat'ed when d_type does not tell (DT_UNKNOWN, some
+// network file systems) or for a symbolic link, and only once its name
+// is accepted, elsewhere every accepted entry is stat'ed
+// subdirectories, unless nullptr, gets the names of the directories in it,
+// symbolic links to directories are not followed so a walk cannot loop
+bool ScanDirectory(const std::string &directoryPath,
+                   const std::function<bool(const std::string&)> &nameFilter,
+                   std::vector<DirectoryEntry> *entries,
+                   std::vector<std::string> *subdirectories = nullptr);
+
+#endif // COMMON_DIRECTORYSCANNER_H_
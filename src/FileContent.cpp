@@ -0,0 +1,105 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ReadWholeFile
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "FileContent.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+using std::string;
+using std::vector;
+
+using boost::filesystem::path;
+using boost::system::error_code;
+
+namespace
+{
+template<typename Container>
+bool ReadRemainingInto(FILE *fileHandle, Container *content)
+{
+    char readBuffer[65536];
+    while(true)
+    {
+        const size_t byteRead = fread(readBuffer, 1, sizeof(readBuffer), fileHandle);
+        if(0 == byteRead)
+        {
+            break;
+        }
+        content->insert(content->end(), readBuffer, readBuffer+byteRead);
+    }
+    return 0 == ferror(fileHandle);
+}
+
+template<typename Container>
+bool ReadWholeFileInto(const string &filePath, Container *content)
+{
+    content->clear();
+    FILE *fileHandle = fopen(filePath.c_str(), "rb");
+    if(nullptr == fileHandle)
+    {
+        return false;
+    }
+    const bool succeeded = ReadRemainingInto(fileHandle, content);
+    fclose(fileHandle);
+    return succeeded;
+}
+}
+
+bool ReadRemaining(FILE *fileHandle, vector<char> *content)
+{
+    return ReadRemainingInto(fileHandle, content);
+}
+
+bool ReadRemaining(FILE *fileHandle, string *content)
+{
+    return ReadRemainingInto(fileHandle, content);
+}
+
+bool ReadWholeFile(const string &filePath, vector<char> *content)
+{
+    return ReadWholeFileInto(filePath, content);
+}
+
+bool ReadWholeFile(const string &filePath, string *content)
+{
+    return ReadWholeFileInto(filePath, content);
+}
+
+bool ReplaceFileContent(const string &filePath, const vector<char> &content)
+{
+    error_code errorCode;
+    const path targetPath(filePath);
+    path tmpPath;
+    FILE *tmpFile = nullptr;
+    for(int attempt = 0; nullptr == tmpFile && attempt < 16; ++attempt)
+    {
+        tmpPath = targetPath.parent_path()/
+                  boost::filesystem::unique_path(targetPath.filename().string()+".%%%%-%%%%.tmp",
+                                                 errorCode);
+        tmpFile = fopen(tmpPath.string().c_str(), "wbx");
+    }
+    if(nullptr == tmpFile)
+    {
+        return false;
+    }
+    const bool written = content.size() == fwrite(content.data(), 1, content.size(), tmpFile);
+    if(0 != fclose(tmpFile) || false == written)
+    {
+        boost::filesystem::remove(tmpPath, errorCode);
+        return false;
+    }
+    boost::filesystem::rename(tmpPath, targetPath, errorCode);
+    if(errorCode)
+    {
+        boost::filesystem::remove(tmpPath, errorCode);
+        return false;
+    }
+    return true;
+}
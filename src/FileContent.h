@@ -0,0 +1,49 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ReadWholeFile
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_FILECONTENT_H_
+#define COMMON_FILECONTENT_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// what is left to read from fileHandle, appended to content
+// false on a read error, fileHandle stays open
+bool ReadRemaining(FILE *fileHandle, std::vector<char> *content);
+bool ReadRemaining(FILE *fileHandle, std::string *content);
+
+// the whole content of filePath, false when it cannot be opened or read
+// nothing is appended: the parsers working in place add their own '\0'
+bool ReadWholeFile(const std::string &filePath, std::vector<char> *content);
+bool ReadWholeFile(const std::string &filePath, std::string *content);
+
+// replace filePath by content at once: written to a unique file of the same
+// directory, so the rename stays on one file system and two runs saving at
+// once do not write into the same file, then renamed over it
+bool ReplaceFileContent(const std::string &filePath, const std::vector<char> &content);
+
+// the binary caches, in the byte order of the machine
+template<typename T>
+T ReadValue(const char *bytes)
+{
+    T value;
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void AppendValue(T value, std::vector<char> *content)
+{
+    const char *bytes = reinterpret_cast<const char*>(&value);
+    content->insert(content->end(), bytes, bytes+sizeof(T));
+}
+
+#endif // COMMON_FILECONTENT_H_
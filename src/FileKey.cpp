@@ -0,0 +1,73 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ReadFileKey
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "FileKey.h"
+
+#include <boost/predef/os.h>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+#if BOOST_OS_WINDOWS == 0
+#include <sys/stat.h>
+#endif
+
+using std::string;
+
+using boost::filesystem::path;
+using boost::system::error_code;
+
+bool operator==(const FileKey &left, const FileKey &right)
+{
+    return left.fileSize == right.fileSize && left.mtimeSeconds == right.mtimeSeconds &&
+           left.mtimeNanoseconds == right.mtimeNanoseconds && left.inode == right.inode;
+}
+
+bool operator!=(const FileKey &left, const FileKey &right)
+{
+    return false == (left == right);
+}
+
+bool ReadFileKey(const string &filePath, FileKey *key)
+{
+#if BOOST_OS_WINDOWS == 0
+    struct stat fileStat;
+    if(0 != stat(filePath.c_str(), &fileStat))
+    {
+        return false;
+    }
+    key->fileSize = static_cast<uint64_t>(fileStat.st_size);
+#if BOOST_OS_MACOS != 0
+    key->mtimeSeconds = static_cast<int64_t>(fileStat.st_mtimespec.tv_sec);
+    key->mtimeNanoseconds = static_cast<int64_t>(fileStat.st_mtimespec.tv_nsec);
+#else
+    key->mtimeSeconds = static_cast<int64_t>(fileStat.st_mtim.tv_sec);
+    key->mtimeNanoseconds = static_cast<int64_t>(fileStat.st_mtim.tv_nsec);
+#endif
+    key->inode = static_cast<uint64_t>(fileStat.st_ino);
+    return true;
+#else
+    error_code errorCode;
+    const auto fileSize = boost::filesystem::file_size(path(filePath), errorCode);
+    if(errorCode)
+    {
+        return false;
+    }
+    const auto mtime = boost::filesystem::last_write_time(path(filePath), errorCode);
+    if(errorCode)
+    {
+        return false;
+    }
+    key->fileSize = static_cast<uint64_t>(fileSize);
+    key->mtimeSeconds = static_cast<int64_t>(mtime);
+    key->mtimeNanoseconds = 0;
+    key->inode = 0;
+    return true;
+#endif
+}
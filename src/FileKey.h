@@ -0,0 +1,32 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ReadFileKey
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_FILEKEY_H_
+#define COMMON_FILEKEY_H_
+
+#include <cstdint>
+#include <string>
+
+// what tells that a file has not changed since something was derived from it
+struct FileKey
+{
+    uint64_t fileSize;
+    int64_t mtimeSeconds;
+    int64_t mtimeNanoseconds;
+    // 0 where the file system has none
+    uint64_t inode;
+};
+
+bool operator==(const FileKey &left, const FileKey &right);
+bool operator!=(const FileKey &left, const FileKey &right);
+
+// stat filePath, returns false when it does not exist
+bool ReadFileKey(const std::string &filePath, FileKey *key);
+
+#endif // COMMON_FILEKEY_H_
@@ -19,17 +19,39 @@
 #include <map>
 #include <functional>
 #include <fstream>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
 
 // External dependences(Only Boost)
+#include <boost/predef/os.h>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
-#include <boost/regex.hpp>
 
 // RapidXml is a head only library
 // so I just import the whole file here
 #include "rapidxml.hpp"
 #include "ProcessInvoke.h"
+#include "ParallelFor.h"
+#include "ProcessEngine.h"
+#include "ConicOrientation.h"
+#include "ImageHeader.h"
+#include "ImageSizeCache.h"
+#include "MicMacMetadata.h"
+#include "ScratchDirectory.h"
+#include "NumberParser.h"
+#include "MappedFile.h"
+#include "GcpReader.h"
+#include "GcpCache.h"
+#include "DirectoryScanner.h"
+#include "ImagePattern.h"
+#include "GcpImageHits.h"
+#include "Console.h"
+#include "FileContent.h"
 
 // using declaration
 // to avoid name space pollution
@@ -46,11 +68,15 @@ using std::transform;
 using std::getline;
 using std::ifstream;
 using std::mismatch;
+using std::sort;
+using std::mutex;
+using std::lock_guard;
+using std::future;
+using std::shared_future;
 
 using boost::filesystem::path;
 using boost::filesystem::is_directory;
 using boost::filesystem::is_regular_file;
-using boost::filesystem::directory_iterator;
 using boost::filesystem::initial_path;
 using boost::system::error_code;
 
@@ -71,6 +97,17 @@ constexpr size_t g_gcpFileArgIndex = 3;
 
 const char* const g_coordFileName = "GCP-Coordinates.txt";
 const char* const g_oriDirPrefix = "Ori-";
+// image sizes of the previous runs, in the dataset directory
+const char* const g_sizeCacheFileName = ".GCP2Imgs-SizeCache.bin";
+// the GCPs of the previous runs, beside the GCP file, with its name in between
+const char* const g_gcpCachePrefix = ".GCP2Imgs-GcpCache-";
+const char* const g_gcpCacheSuffix = ".bin";
+// where MicMac keeps its per image metadata
+const char* const g_tmpMmDirName = "Tmp-MM-Dir";
+// GcpParser=auto parses the GCP files larger than this in parallel
+constexpr uintmax_t g_gcpParallelThreshold = 4*1024*1024;
+// or streams them without threads
+constexpr uintmax_t g_gcpStreamThreshold = 64*1024*1024;
 
 // effect: SomeName -> Ori-SomeName
 void AddOriPrefixIfNotExisted(string *oriDirName)
@@ -93,21 +130,29 @@ void PrintHelp()
 Mandatory unnamed args :\n\
   * string :: {Full Directory (Dir+Pattern)}\n\
   * string :: {Orientations}\n\
-  * string :: {Ground Control Points File}\n\
+  * string :: {Ground Control Points File, DicoAppuisFlottant XML, \"name x y z\" text or binary PLY, told by the content}\n\
 Named args :\n\
   * [Name=Out] string :: {Directory of Output Fils(s), Default=GCP-IMG}\n\
   * [Name=Pattern] bool :: {Output in pattern or images list, Default=true}\n\
-  * [Name=InitPath] string :: {mm3d bin path}\n"<<endl;
+  * [Name=Dirs] string :: {More image directories below the dataset one, comma separated, images named by their relative path}\n\
+  * [Name=Recursive] bool :: {Images of the subdirectories too, Ori-*, Tmp-MM-Dir and hidden ones excepted, Default=false}\n\
+  * [Name=ImageList] string :: {File of the image names, one per line or NUL separated, - for stdin, replaces the pattern, Dirs and Recursive}\n\
+  * [Name=InitPath] string :: {mm3d bin path}\n\
+  * [Name=Threads] int :: {Number of images processed at once, Default=hardware concurrency}\n\
+  * [Name=Processes] int :: {Number of mm3d/exiv2 running at once, Default=hardware concurrency}\n\
+  * [Name=Engine] string :: {Projection by mm3d XYZ2Im or native, Default=mm3d}\n\
+  * [Name=SizeFromCalib] bool :: {Image size from the calibration SzIm, EXIF only without it, Default=false}\n\
+  * [Name=SizeCache] bool :: {Keep the image sizes in the dataset for the next runs, Default=true}\n\
+  * [Name=GcpCache] bool :: {Keep the GCPs read from the GCP file for the next runs, Default=true}\n\
+  * [Name=ExivBatch] int :: {Number of images per exiv2 run, Default=256}\n\
+  * [Name=Scratch] string :: {Directory for the temporary files, Default=$XDG_RUNTIME_DIR or /dev/shm}\n\
+  * [Name=Xyz2ImPipe] bool :: {XYZ2Im reads and writes through /proc/self/fd (Linux), false for files of the scratch directory, Default=true}\n\
+  * [Name=GcpParser] string :: {GCP XML file read by dom, stream, parallel or auto (parallel above 4 MB, stream above 64 MB on one thread), Default=auto}\n"<<endl;
 }
 
-bool ValidateArgumentsAndPrompt(const path &oriDirPath, const path &gcpFilePath)
+bool ValidateArgumentsAndPrompt(const path &gcpFilePath)
 {
-    // validate orientations directory
-    if(false == is_directory(oriDirPath))
-    {
-        cout<<endl<<"Cannot find orientations directory: "<<oriDirPath.string()<<endl;
-        return false;
-    }
+    // the orientations directory is validated per image directory, once they are known
     // validate Ground Control Points File
     if(false == is_regular_file(gcpFilePath))
     {
@@ -119,70 +164,343 @@ bool ValidateArgumentsAndPrompt(const path &oriDirPath, const path &gcpFilePath)
     return true;
 }
 
-// filter the images that user excludes by regular expression
-bool FileterImagesByPattern(const string &allImagePattern, set<string> *imagesList)
+// the subdirectories a recursive selection does not enter: MicMac keeps
+// one file per image in Ori-* and Tmp-MM-Dir
+bool IsWalkedDirectory(const string &directoryName)
+{
+    return '.' != directoryName[0] && g_tmpMmDirName != directoryName &&
+           0 != directoryName.compare(0, strlen(g_oriDirPrefix), g_oriDirPrefix);
+}
+
+// relativePath below the dataset directory as "a/b", "" for the directory itself
+// false when it is absolute or goes up
+bool NormalizeRelativePath(const string &relativePath, string *normalizedPath)
+{
+    normalizedPath->clear();
+    const path pathToNormalize(relativePath);
+    if(pathToNormalize.has_root_path())
+    {
+        return false;
+    }
+    for(const auto &element : pathToNormalize)
+    {
+        const string name(element.string());
+        if(".." == name)
+        {
+            return false;
+        }
+        if(name.empty() || "." == name || "/" == name)
+        {
+            continue;
+        }
+        if(false == normalizedPath->empty())
+        {
+            normalizedPath->push_back('/');
+        }
+        normalizedPath->append(name);
+    }
+    return true;
+}
+
+// filter the images that user excludes by regular expression, in the directory
+// of the pattern, in the imageDirs below it and, when recursive, in their
+// subdirectories, the directories of one level are read in parallel
+// an image is named by its path relative to the directory of the pattern
+// imageFileKeys gets the stat of the images the scan had to stat
+bool FileterImagesByPattern(const string &allImagePattern, const vector<string> &imageDirs,
+                            bool recursive, unsigned threadCount,
+                            set<string> *imagesList, map<string,FileKey> *imageFileKeys)
 {
     imagesList->clear();
-    boost::regex regularExpression;
+    imageFileKeys->clear();
     const path patternPath(allImagePattern);
-    regularExpression.set_expression(patternPath.filename().string());
-    boost::match_results<string::const_iterator> what;
+    const path datasetRoot = patternPath.parent_path();
+    const ImagePattern imagePattern(patternPath.filename().string());
+    vector<string> level(1, string());
+    for(const auto &imageDir : imageDirs)
+    {
+        level.emplace_back();
+        if(false == NormalizeRelativePath(imageDir, &level.back()))
+        {
+            cout<<endl<<"Image directories must be below "<<datasetRoot.string()<<": "<<imageDir<<endl;
+            return false;
+        }
+    }
+    set<string> visitedDirs;
+    vector<string> directories;
+    vector<vector<DirectoryEntry>> entries;
+    vector<vector<string>> subdirectories;
+    vector<char> scanned;
+    for(bool firstLevel = true; false == level.empty(); firstLevel = false)
+    {
+        directories.clear();
+        for(auto &directory : level)
+        {
+            if(visitedDirs.insert(directory).second)
+            {
+                directories.push_back(std::move(directory));
+            }
+        }
+        entries.assign(directories.size(), vector<DirectoryEntry>());
+        subdirectories.assign(directories.size(), vector<string>());
+        scanned.assign(directories.size(), 0);
+        // we only focus on image file, matched before anything is stat'ed
+        ParallelFor(directories.size(), threadCount, [&](size_t dirIndex, unsigned)
+        {
+            scanned[dirIndex] = ScanDirectory((datasetRoot/directories[dirIndex]).string(),
+                                              [&imagePattern](const string &imageName)
+                                              {
+                                                  return imagePattern.Match(imageName);
+                                              }, &entries[dirIndex],
+                                              recursive ? &subdirectories[dirIndex] : nullptr);
+        });
+        level.clear();
+        for(size_t dirIndex = 0; directories.size() != dirIndex; ++dirIndex)
+        {
+            const string &directory = directories[dirIndex];
+            const string prefix(directory.empty() ? directory : directory+'/');
+            if(0 == scanned[dirIndex])
+            {
+                cout<<endl<<"Cannot read the images directory: "<<(datasetRoot/directory).string()<<endl;
+                // the walk goes on without the subdirectories it cannot read
+                if(firstLevel)
+                {
+                    return false;
+                }
+                continue;
+            }
+            for(const auto &entry : entries[dirIndex])
+            {
+                imagesList->insert(prefix+entry.name);
+                if(entry.keyKnown)
+                {
+                    (*imageFileKeys)[prefix+entry.name] = entry.key;
+                }
+            }
+            for(const auto &subdirectory : subdirectories[dirIndex])
+            {
+                if(IsWalkedDirectory(subdirectory))
+                {
+                    level.push_back(prefix+subdirectory);
+                }
+            }
+        }
+    }
+    return false == imagesList->empty();
+}
+
+// the images named in imageListPath, "-" for the standard input, taken as they
+// are, without listing or stat'ing anything: one name per line, or NUL
+// separated when the list has a NUL, relative to the dataset directory
+bool ReadImageList(const path &datasetRoot, const string &imageListPath, set<string> *imagesList)
+{
+    imagesList->clear();
+    const bool fromStdin = "-" == imageListPath;
+    const string listFilePath(path(imageListPath).is_absolute() ? imageListPath :
+                              (datasetRoot/imageListPath).string());
+    FILE *fileHandle = fromStdin ? stdin : fopen(listFilePath.c_str(), "rb");
+    if(nullptr == fileHandle)
+    {
+        cout<<endl<<"Cannot open the image list: "<<listFilePath<<endl;
+        return false;
+    }
+    string content;
+    const bool readFailed = false == ReadRemaining(fileHandle, &content);
+    if(false == fromStdin)
+    {
+        fclose(fileHandle);
+    }
+    if(readFailed)
+    {
+        cout<<endl<<"Cannot read the image list: "<<(fromStdin ? string("stdin") : listFilePath)<<endl;
+        return false;
+    }
+    const char separator = string::npos == content.find('\0') ? '\n' : '\0';
+    const char *name = content.data();
+    const char* const contentEnd = name+content.size();
     string imageName;
-    for(directory_iterator iter(patternPath.parent_path()), end; end != iter; ++iter)
+    while(contentEnd != name)
     {
-        if(false == is_regular_file(*iter))
+        const char *nameEnd = static_cast<const char*>(memchr(name, separator, contentEnd-name));
+        if(nullptr == nameEnd)
+        {
+            nameEnd = contentEnd;
+        }
+        imageName.assign(name, nameEnd);
+        name = contentEnd == nameEnd ? nameEnd : nameEnd+1;
+        if('\n' == separator && false == imageName.empty() && '\r' == imageName.back())
+        {
+            imageName.pop_back();
+        }
+        if(imageName.empty())
         {
-            // we only focus on image file
             continue;
         }
-        imageName = iter->path().filename().string();
-        if(false == boost::regex_match(imageName, what, regularExpression))
+        // most names are plain file names of the dataset directory
+        if(string::npos == imageName.find('/') && "." != imageName && ".." != imageName)
         {
+            imagesList->insert(imageName);
             continue;
         }
-        imagesList->insert(imageName);
+        string relativeName;
+        if(false == NormalizeRelativePath(imageName, &relativeName) || relativeName.empty())
+        {
+            cout<<endl<<"Images of the image list must be below "<<datasetRoot.string()<<": "<<imageName<<endl;
+            return false;
+        }
+        imagesList->insert(relativeName);
     }
-    return false == imagesList->empty();
+    if(imagesList->empty())
+    {
+        cout<<endl<<"No image in the image list: "<<(fromStdin ? string("stdin") : listFilePath)<<endl;
+        return false;
+    }
+    return true;
+}
+
+// the directory of the orientations of the images of a directory
+struct OrientationDirectory
+{
+    path oriDirPath;
+    // where the orientations find their calibrations
+    path projectRoot;
+};
+
+// the directory part of an image name, "" for the images of the dataset directory
+string ImageDirectoryOf(const string &imageName)
+{
+    const size_t slashIndex = imageName.rfind('/');
+    return string::npos == slashIndex ? string() : imageName.substr(0, slashIndex);
 }
 
-// read GCP XML file content
-bool ReadGcpXmlFile(const char* const gcpFilePath, xml_document<> *gcpXml)
+// the orientations of the images of a subdirectory are looked for in its
+// own oriDirName, then in the one of the dataset directory, the images
+// without any are dropped, false when none is left
+bool ResolveOrientationDirectories(const path &datasetRoot, const string &oriDirName,
+                                   set<string> *selectedImages,
+                                   map<string,OrientationDirectory> *orientationDirs)
 {
-    char readBuffer[2048];
-    string xmlContent;
-    FILE *gcpFileHandle = fopen(gcpFilePath, "rb");
-    if(nullptr == gcpFileHandle)
+    orientationDirs->clear();
+    const path rootOriDirPath(datasetRoot/oriDirName);
+    const bool rootOriFound = is_directory(rootOriDirPath);
+    set<string> missingDirs;
+    for(auto imageIter = selectedImages->begin(); selectedImages->end() != imageIter;)
+    {
+        const string imageDir(ImageDirectoryOf(*imageIter));
+        if(orientationDirs->end() == orientationDirs->find(imageDir) &&
+           missingDirs.end() == missingDirs.find(imageDir))
+        {
+            const path projectRoot(datasetRoot/imageDir);
+            if(false == imageDir.empty() && is_directory(projectRoot/oriDirName))
+            {
+                (*orientationDirs)[imageDir] = {projectRoot/oriDirName, projectRoot};
+            }
+            else if(rootOriFound)
+            {
+                (*orientationDirs)[imageDir] = {rootOriDirPath, datasetRoot};
+            }
+            else
+            {
+                missingDirs.insert(imageDir);
+                cout<<endl<<"Cannot find orientations directory: "
+                    <<(imageDir.empty() ? rootOriDirPath : projectRoot/oriDirName).string()<<endl;
+            }
+        }
+        if(missingDirs.end() != missingDirs.find(imageDir))
+        {
+            imageIter = selectedImages->erase(imageIter);
+        }
+        else
+        {
+            ++imageIter;
+        }
+    }
+    return false == selectedImages->empty();
+}
+
+// read GCP XML file content, hashed into contentHasher unless it is nullptr
+// the document points into gcpContent, which must outlive it
+bool ReadGcpXmlFile(const char* const gcpFilePath, MappedFile *gcpContent, xml_document<> *gcpXml,
+                    ContentHasher *contentHasher)
+{
+    if(false == gcpContent->Open(gcpFilePath))
     {
         cout<<endl<<"Cannot open GCP file: "<<gcpFilePath<<endl;
         return false;
     }
-    while(true)
+    // before the parse, which writes into the content
+    if(nullptr != contentHasher)
     {
-        const size_t byteRead = fread(readBuffer, 1, sizeof(readBuffer), gcpFileHandle);
-        if(0 == byteRead)
-        {
-            break;
-        }
-        xmlContent.append(readBuffer, readBuffer+byteRead);
+        contentHasher->Update(gcpContent->Data(), gcpContent->Size());
+    }
+    try
+    {
+        gcpXml->parse<rapidxml::parse_no_utf8>(gcpContent->Data());
+    }
+    catch(const rapidxml::parse_error &error)
+    {
+        cout<<endl<<"Invalid GCP file: "<<error.what()<<endl;
+        return false;
     }
-    fclose(gcpFileHandle);
-    gcpXml->parse<rapidxml::parse_no_utf8>((char*)xmlContent.c_str());
     return true;
 }
 
-// GCP data structure
-struct GcpData
+// how the GCP file is read
+enum class GcpParser
 {
-    string name;
-    double x, y, z;
+    // rapidxml DOM of the whole file
+    Dom,
+    // GcpStreamReader, constant memory
+    Stream,
+    // the mapped file cut between GCPs and parsed on all threads
+    Parallel,
+    // Parallel for the large files when there are threads, else Stream
+    // for the very large ones, Dom for the others
+    Auto
 };
 
-// fetch all GCP data from XML file and fill into gcpDat
-bool FetchAllGcps(const char* const gcpFilePath, vector<GcpData> *gcpDat)
+// a ByteSource that hashes what is read through it, for the GCP cache
+class HashingSource : public ByteSource
+{
+public:
+    // contentHasher may be nullptr, nothing is hashed then
+    HashingSource(ByteSource *source, ContentHasher *contentHasher)
+        : m_source(source), m_contentHasher(contentHasher)
+    {}
+    size_t Read(char *buffer, size_t size) override
+    {
+        const size_t byteRead = m_source->Read(buffer, size);
+        if(nullptr != m_contentHasher)
+        {
+            m_contentHasher->Update(buffer, byteRead);
+        }
+        return byteRead;
+    }
+    // the readers stop after the last GCP, what follows is hashed too
+    void Drain()
+    {
+        if(nullptr == m_contentHasher)
+        {
+            return;
+        }
+        char buffer[64*1024];
+        while(0 != Read(buffer, sizeof(buffer)))
+        {}
+    }
+
+private:
+    ByteSource *m_source;
+    ContentHasher *m_contentHasher;
+};
+
+// fetch all GCP data from XML file and fill into gcpDat, through a DOM
+bool FetchAllGcpsFromDom(const char* const gcpFilePath, vector<GcpData> *gcpDat,
+                         ContentHasher *contentHasher)
 {
     gcpDat->clear();
+    MappedFile gcpContent;
     xml_document<> gcpXml;
-    if(false == ReadGcpXmlFile(gcpFilePath, &gcpXml))
+    if(false == ReadGcpXmlFile(gcpFilePath, &gcpContent, &gcpXml, contentHasher))
     {
         return false;
     }
@@ -192,7 +510,7 @@ bool FetchAllGcps(const char* const gcpFilePath, vector<GcpData> *gcpDat)
         cout<<endl<<"Invalid GCP file, target node name: dicoAppuisFlottant"<<endl;
         return false;
     }
-    string tmp;
+    GcpData dat;
     for(const xml_node<> *gcpNode = dicoAppuisFlottant->first_node("OneAppuisDAF");
         nullptr != gcpNode; gcpNode = gcpNode->next_sibling())
     {
@@ -208,31 +526,112 @@ bool FetchAllGcps(const char* const gcpFilePath, vector<GcpData> *gcpDat)
             cout<<endl<<"Invalid GCP file, cannot find GCP name field"<<endl;
             return false;
         }
-        tmp.assign(coord->value(), coord->value()+coord->value_size());
-        const size_t firstSpace = tmp.find_first_of(' ');
-        if(string::npos == firstSpace)
-        {
-            cout<<endl<<"Invalid GCP file: cannot find first space"<<endl;
-            return false;
-        }
-        const size_t secondSpace = tmp.find_first_of(' ', firstSpace+1);
-        if(string::npos == secondSpace)
+        if(false == ParseGcpPoint(coord->value(), coord->value_size(), &dat))
         {
-            cout<<endl<<"Invalid GCP file: cannot second first space"<<endl;
             return false;
         }
-        gcpDat->emplace_back();
-        GcpData &dat = gcpDat->back();
-        dat.x = atof(tmp.substr(0, firstSpace).c_str());
-        dat.y = atof(tmp.substr(firstSpace+1, secondSpace-firstSpace-1).c_str());
-        dat.z = atof(tmp.substr(secondSpace+1).c_str());
         dat.name.assign(gcpName->value(), gcpName->value()+gcpName->value_size());
+        gcpDat->push_back(dat);
     }
     return true;
 }
 
-// create coordinates file for XYZ2Im
-bool WriteGcpsCoordToFile(const path &outputDir, const vector<GcpData> &gcpDat)
+// fetch all GCP data from a file of format and fill into gcpDat, one GCP
+// at a time, only the GCPs themselves are held in memory
+bool FetchAllGcpsFromStream(const char* const gcpFilePath, GcpFileFormat format,
+                            vector<GcpData> *gcpDat, ContentHasher *contentHasher)
+{
+    gcpDat->clear();
+    const auto fileSource = OpenReadAheadFile(gcpFilePath);
+    if(nullptr == fileSource)
+    {
+        cout<<endl<<"Cannot open GCP file: "<<gcpFilePath<<endl;
+        return false;
+    }
+    HashingSource source(fileSource.get(), contentHasher);
+    const auto reader = MakeGcpReader(format, &source);
+    GcpData dat;
+    while(reader->Next(&dat))
+    {
+        gcpDat->push_back(dat);
+    }
+    if(false == reader->Good())
+    {
+        return false;
+    }
+    source.Drain();
+    return true;
+}
+
+// fetch all GCP data from XML file and fill into gcpDat, on threadCount threads
+bool FetchAllGcpsInParallel(const char* const gcpFilePath, unsigned threadCount,
+                            vector<GcpData> *gcpDat, ContentHasher *contentHasher)
+{
+    MappedFile gcpContent;
+    if(false == gcpContent.Open(gcpFilePath))
+    {
+        cout<<endl<<"Cannot open GCP file: "<<gcpFilePath<<endl;
+        return false;
+    }
+    if(nullptr != contentHasher)
+    {
+        contentHasher->Update(gcpContent.Data(), gcpContent.Size());
+    }
+    if(ReadGcpsInParallel(gcpContent.Data(), gcpContent.Size(), threadCount, gcpDat))
+    {
+        return true;
+    }
+    // cannot be cut, or invalid: read it in one piece, which tells what is wrong
+    gcpDat->clear();
+    const auto source = OpenMemory(gcpContent.Data(), gcpContent.Size());
+    GcpStreamReader reader(source.get());
+    GcpData dat;
+    while(reader.Next(&dat))
+    {
+        gcpDat->push_back(dat);
+    }
+    return reader.Good();
+}
+
+// fetch all GCP data from the GCP file and fill into gcpDat, parser only
+// chooses how the XML files are read, the other formats are streamed
+// the bytes the GCPs are parsed from go to contentHasher unless it is nullptr
+bool FetchAllGcps(const path &gcpFilePath, GcpParser parser, unsigned threadCount,
+                  vector<GcpData> *gcpDat, ContentHasher *contentHasher)
+{
+    const GcpFileFormat format = GcpFileFormatOf(gcpFilePath.string());
+    if(GcpFileFormat::Xml != format)
+    {
+        return FetchAllGcpsFromStream(gcpFilePath.string().c_str(), format, gcpDat, contentHasher);
+    }
+    if(GcpParser::Auto == parser)
+    {
+        error_code errorCode;
+        const auto fileSize = boost::filesystem::file_size(gcpFilePath, errorCode);
+        parser = GcpParser::Dom;
+        if(false == static_cast<bool>(errorCode) && fileSize > g_gcpParallelThreshold && threadCount > 1)
+        {
+            parser = GcpParser::Parallel;
+        }
+        else if(false == static_cast<bool>(errorCode) && fileSize > g_gcpStreamThreshold)
+        {
+            parser = GcpParser::Stream;
+        }
+    }
+    switch(parser)
+    {
+    case GcpParser::Stream:
+        return FetchAllGcpsFromStream(gcpFilePath.string().c_str(), format, gcpDat, contentHasher);
+    case GcpParser::Parallel:
+        return FetchAllGcpsInParallel(gcpFilePath.string().c_str(), threadCount, gcpDat,
+                                      contentHasher);
+    default:
+        return FetchAllGcpsFromDom(gcpFilePath.string().c_str(), gcpDat, contentHasher);
+    }
+}
+
+// coordinates for XYZ2Im, "x y z" per line
+string FormatGcpsCoord(const vector<GcpData> &gcpDat)
 {
     ostringstream stringStream;
     stringStream<<std::setprecision(3)<<std::fixed;
@@ -243,7 +642,12 @@ bool WriteGcpsCoordToFile(const path &outputDir, const vector<GcpData> &gcpDat)
     string posContent(stringStream.str());
     // remove the last endl
     posContent.pop_back();
+    return posContent;
+}
 
+// create coordinates file for XYZ2Im
+bool WriteGcpsCoordToFile(const path &outputDir, const string &posContent)
+{
     FILE *fileHandle = fopen((outputDir/g_coordFileName).string().c_str(), "wb");
     if(nullptr == fileHandle)
     {
@@ -255,30 +659,174 @@ bool WriteGcpsCoordToFile(const path &outputDir, const vector<GcpData> &gcpDat)
     return true;
 }
 
+// where the GCPs are projected into the images
+enum class ProjectionEngine
+{
+    // mm3d XYZ2Im, one process per image
+    Mm3d,
+    // ConicOrientation, in this process
+    Native
+};
+
+// named arguments, see PrintHelp
+struct OptionalArgs
+{
+    string outputDirName = "GCP-IMG";
+    // mm3d bin path
+    string initPath;
+    bool pattern = true;
+    unsigned threadCount = 1;
+    unsigned processCount = 1;
+    ProjectionEngine engine = ProjectionEngine::Mm3d;
+    bool sizeFromCalib = false;
+    bool sizeCache = true;
+    bool gcpCache = true;
+    // images per exiv2 run
+    size_t exivBatchSize = 256;
+    // where the scratch directory is made, empty for a tmpfs
+    string scratchPath;
+    // XYZ2Im writes into a pipe where the engine can hand it one, for the
+    // mm3d builds that cannot write to a non-seekable file it is turned off
+    bool xyz2ImPipe = true;
+    GcpParser gcpParser = GcpParser::Auto;
+    // more image directories, relative to the dataset one
+    vector<string> imageDirs;
+    bool recursive = false;
+    // the images are read from there instead of scanned, "-" for stdin
+    string imageListPath;
+};
+
 // parse and fetch optional argument
-void FetchOptionalArg(const int argc,char **argv,
-                      string *outputDirName, string *initPath, bool *pattern)
+void FetchOptionalArg(const int argc,char **argv, OptionalArgs *args)
 {
     if(g_mandatoryArgCount+1 >= argc)
     {
         return;
     }
     map<string,function<void(const string&)>> funcMap;
-    funcMap["Out"] = [outputDirName](const string &value){*outputDirName = value;};
-    funcMap["Pattern"] = [pattern](const string &value)
+    funcMap["Out"] = [args](const string &value){args->outputDirName = value;};
+    funcMap["Pattern"] = [args](const string &value)
     {
         string tmp(value);
         transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
         if(tmp == "true")
         {
-            *pattern = true;
+            args->pattern = true;
         }
         else if(tmp == "false" || 0==atoi(tmp.c_str()))
         {
-            *pattern = false;
+            args->pattern = false;
+        }
+    };
+    funcMap["InitPath"] = [args](const string &value){args->initPath = value;};
+    funcMap["Dirs"] = [args](const string &value)
+    {
+        args->imageDirs.clear();
+        size_t begin = 0;
+        while(begin <= value.size())
+        {
+            size_t end = value.find(',', begin);
+            if(string::npos == end)
+            {
+                end = value.size();
+            }
+            if(end != begin)
+            {
+                args->imageDirs.push_back(value.substr(begin, end-begin));
+            }
+            begin = end+1;
+        }
+    };
+    funcMap["ImageList"] = [args](const string &value){args->imageListPath = value;};
+    funcMap["Recursive"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        args->recursive = tmp == "true" || 0 != atoi(tmp.c_str());
+    };
+    funcMap["Scratch"] = [args](const string &value){args->scratchPath = value;};
+    funcMap["Xyz2ImPipe"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        args->xyz2ImPipe = tmp == "true" || 0 != atoi(tmp.c_str());
+    };
+    funcMap["Threads"] = [args](const string &value)
+    {
+        const int count = atoi(value.c_str());
+        if(count > 0)
+        {
+            args->threadCount = static_cast<unsigned>(count);
+        }
+    };
+    funcMap["Processes"] = [args](const string &value)
+    {
+        const int count = atoi(value.c_str());
+        if(count > 0)
+        {
+            args->processCount = static_cast<unsigned>(count);
+        }
+    };
+    funcMap["Engine"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        if(tmp == "native")
+        {
+            args->engine = ProjectionEngine::Native;
+        }
+        else if(tmp == "mm3d")
+        {
+            args->engine = ProjectionEngine::Mm3d;
+        }
+    };
+    funcMap["SizeFromCalib"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        args->sizeFromCalib = tmp == "true" || 0 != atoi(tmp.c_str());
+    };
+    funcMap["SizeCache"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        args->sizeCache = tmp == "true" || 0 != atoi(tmp.c_str());
+    };
+    funcMap["GcpCache"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        args->gcpCache = tmp == "true" || 0 != atoi(tmp.c_str());
+    };
+    funcMap["ExivBatch"] = [args](const string &value)
+    {
+        const int count = atoi(value.c_str());
+        if(count > 0)
+        {
+            args->exivBatchSize = static_cast<size_t>(count);
+        }
+    };
+    funcMap["GcpParser"] = [args](const string &value)
+    {
+        string tmp(value);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        if(tmp == "dom")
+        {
+            args->gcpParser = GcpParser::Dom;
+        }
+        else if(tmp == "stream")
+        {
+            args->gcpParser = GcpParser::Stream;
+        }
+        else if(tmp == "parallel")
+        {
+            args->gcpParser = GcpParser::Parallel;
+        }
+        else if(tmp == "auto")
+        {
+            args->gcpParser = GcpParser::Auto;
         }
     };
-    funcMap["InitPath"] = [initPath](const string &value){*initPath = value;};
     string argument;
     for(int index = g_mandatoryArgCount+1;argc != index; ++index)
     {
@@ -357,10 +905,10 @@ void GetImagesPattern(const vector<string> &imagesName, string *pattern)
     pattern->append(firstBegin+(firstStringSize-lastDiffR), firstEnd);
 }
 
-using Gcp2ImgsMapType = map<string,vector<string>>;
-
-// write the final result to file
-bool WriteGcp2ImgsToFile(const Gcp2ImgsMapType &gcp2ImgsMap, const path &outputDir, bool pattern)
+// write the final result to file, the images of each GCP are given by
+// gcpImages, as indices of images, the GCPs of the same name share their file
+bool WriteGcp2ImgsToFile(const vector<GcpData> &gcpDat, const vector<string> &images,
+                         const SparseRows &gcpImages, const path &outputDir, bool pattern)
 {
     string fileContent;
     string outputFilePath;
@@ -374,24 +922,59 @@ bool WriteGcp2ImgsToFile(const Gcp2ImgsMapType &gcp2ImgsMap, const path &outputD
             return false;
         }
     }
-    assert(false == gcp2ImgsMap.empty() && "\ngcp2ImgsMap Cannot be empty\n");
-    for(const auto &record : gcp2ImgsMap)
+    assert(false == gcpImages.columns.empty() && "\ngcpImages Cannot be empty\n");
+    // the GCPs seen in some image, by name
+    vector<uint32_t> gcpOrder;
+    for(size_t gcpIndex = 0; gcpDat.size() != gcpIndex; ++gcpIndex)
     {
+        if(gcpImages.offsets[gcpIndex] != gcpImages.offsets[gcpIndex+1])
+        {
+            gcpOrder.push_back(static_cast<uint32_t>(gcpIndex));
+        }
+    }
+    std::stable_sort(gcpOrder.begin(), gcpOrder.end(), [&gcpDat](uint32_t first, uint32_t second)
+    {
+        return gcpDat[first].name < gcpDat[second].name;
+    });
+    vector<uint32_t> imageIndices;
+    vector<string> imageNames;
+    for(size_t orderIndex = 0; gcpOrder.size() != orderIndex;)
+    {
+        const string &gcpName = gcpDat[gcpOrder[orderIndex]].name;
+        imageIndices.clear();
+        size_t gcpCount = 0;
+        for(; gcpOrder.size() != orderIndex && gcpName == gcpDat[gcpOrder[orderIndex]].name;
+            ++orderIndex, ++gcpCount)
+        {
+            const uint32_t gcpIndex = gcpOrder[orderIndex];
+            imageIndices.insert(imageIndices.end(), gcpImages.columns.begin()+gcpImages.offsets[gcpIndex],
+                                gcpImages.columns.begin()+gcpImages.offsets[gcpIndex+1]);
+        }
+        // images are indexed in name order, a row is already sorted
+        if(gcpCount > 1)
+        {
+            sort(imageIndices.begin(), imageIndices.end());
+        }
         fileContent.clear();
         if(pattern)
         {
-            GetImagesPattern(record.second, &fileContent);
+            imageNames.clear();
+            for(const uint32_t imageIndex : imageIndices)
+            {
+                imageNames.push_back(images[imageIndex]);
+            }
+            GetImagesPattern(imageNames, &fileContent);
         }
         else
         {
-            for(const auto &img : record.second)
+            for(const uint32_t imageIndex : imageIndices)
             {
-                fileContent += img;
+                fileContent += images[imageIndex];
                 fileContent.push_back('\n');
             }
             fileContent.pop_back();
         }
-        outputFilePath = (outputDir/(record.first+"-GCP2IMGS.txt")).string();
+        outputFilePath = (outputDir/(gcpName+"-GCP2IMGS.txt")).string();
         FILE *fileHandle = fopen(outputFilePath.c_str(), "wb") ;
         if(nullptr == fileHandle)
         {
@@ -410,8 +993,8 @@ struct Exif
     std::string name;
     //size_t fileSize;
     //std::string mimeType;
-    size_t width;
-    size_t height;
+    size_t width = 0;
+    size_t height = 0;
     // [TODO] to be continue
 };
 
@@ -436,133 +1019,571 @@ void ExtractImageSize(string &text, Exif *exif)
     exif->height = atoi(string(begin+xPos+1, removedEnd).c_str());
 }
 
-bool GetImageFileExif(const string &imageFilePath, const string &exivBinPath, Exif *exif)
+// one line of "exiv2 pr": "Key     : value"
+void ParseExivSummaryLine(const char *text, Exif *exif)
+{
+    // set ':' as a seperator
+    const char *colon = strchr(text, ':');
+    if(nullptr == colon)
+    {
+        return;
+    }
+    string firstPart(text, colon);
+    // remove all white space
+    const auto removedEnd = remove(firstPart.begin(), firstPart.end(), ' ');
+    firstPart.resize(removedEnd - firstPart.begin());
+    transform(firstPart.begin(), firstPart.end(), firstPart.begin(), ::tolower);
+    if(firstPart == "imagesize")
+    {
+        string secondPart(colon+1, text+strlen(text));
+        ExtractImageSize(secondPart, exif);
+    }
+    else if(firstPart == "filename")
+    {
+        string secondPart(colon+1, text+strlen(text));
+        ExtractImageName(secondPart, exif);
+    }
+}
+
+// image size from the file header, no process needed
+bool ReadImageFileHeader(const string &imageFilePath, Exif *exif)
 {
-    if(false == is_regular_file(path(imageFilePath)))
+    if(false == ReadImageSizeFromHeader(imageFilePath, &exif->width, &exif->height))
     {
         return false;
     }
-    const vector<string> arguments = {"pr", imageFilePath};
-    ProcessInvoke("", exivBinPath, arguments, [exif](const char *text)
+    exif->name = path(imageFilePath).filename().string();
+    return true;
+}
+
+// the arguments of one exiv2 run stay far below ARG_MAX whatever ExivBatch is
+constexpr size_t g_exivBatchArgBytes = 64*1024;
+
+// the images of one exiv2 run
+struct ExivBatch
+{
+    vector<string> imageFilePaths;
+    // what exiv2 printed per image, the size stays 0 when it printed none
+    vector<Exif> exifs;
+    // the image of the previous line, the lines of one image come together
+    size_t lastImage = 0;
+    shared_future<int> done;
+};
+
+// one line of "exiv2 pr": "Image size      : 6000 x 4000"
+// with several files every line starts with the path of its image
+void ParseExivBatchLine(const char *text, ExivBatch *batch)
+{
+    const size_t imageCount = batch->imageFilePaths.size();
+    size_t imageIndex = 0;
+    const char *summaryText = text;
+    if(1 != imageCount)
     {
-        map<string,function<void(string&, Exif*)>> infoExtactorMap;
-        infoExtactorMap[string("imagesize")] = ExtractImageSize;
-        infoExtactorMap[string("filename")] = ExtractImageName;
-        // set ':' as a seperator
-        const char *colon = strchr(text, ':');
-        if(nullptr == colon)
+        size_t prefixLength = 0;
+        for(size_t offset = 0; imageCount != offset; ++offset)
         {
-            return;
+            const size_t candidate = (batch->lastImage+offset)%imageCount;
+            const string &imageFilePath = batch->imageFilePaths[candidate];
+            if(imageFilePath.size() > prefixLength &&
+               0 == strncmp(text, imageFilePath.c_str(), imageFilePath.size()) &&
+               ' ' == text[imageFilePath.size()])
+            {
+                // the longest path wins, "a.jpg" is a prefix of "a.jpg 2.jpg"
+                imageIndex = candidate;
+                prefixLength = imageFilePath.size();
+            }
         }
-        string firstPart(text, colon);
-        // remove all white space
-        const auto removedEnd = remove(firstPart.begin(), firstPart.end(), ' ');
-        firstPart.resize(removedEnd - firstPart.begin());
-        transform(firstPart.begin(), firstPart.end(), firstPart.begin(), ::tolower);
-        const auto extractor = infoExtactorMap.find(firstPart);
-        if(extractor == infoExtactorMap.end())
+        if(0 == prefixLength)
         {
             return;
         }
-        string secondPart(colon+1, text+strlen(text));
-        extractor->second(secondPart, exif);
-    });
-    return true;
+        batch->lastImage = imageIndex;
+        summaryText = text+prefixLength;
+    }
+    ParseExivSummaryLine(summaryText, &batch->exifs[imageIndex]);
 }
 
-// update the mapping data, the map is about GCP to images
-void UpdateGcp2ImgsMap(const vector<GcpData> &gcpDat,
-                       const string &gcpInImgCoordsFilePath,
-                       const Exif &exif, Gcp2ImgsMapType *targetMap)
+// queue one exiv2 run per batch of imageFilePaths, at most batchSize images
+// and g_exivBatchArgBytes of paths each, the batches are filled on the engine
+// thread and can be read once their done future is ready
+// the size is the "Image size" exiv2 decodes from the image, as a run per
+// image gives it: the Exif PixelX/YDimension may be stale after an edit and
+// IFD0 is a preview in the raw files the header reader leaves to exiv2
+void SubmitExivBatches(const vector<string> &imageFilePaths, size_t batchSize,
+                       const string &exivBinPath, ProcessEngine *processEngine,
+                       vector<ExivBatch> *batches)
 {
-    ifstream inFile;
-    inFile.open(gcpInImgCoordsFilePath, std::ifstream::binary|std::ifstream::in);
-    if(false == inFile.is_open())
+    batches->clear();
+    size_t argBytes = 0;
+    for(const string &imageFilePath : imageFilePaths)
     {
-        cout<<"not found image coordinate file: "<<gcpInImgCoordsFilePath<<endl;
-        return;
+        if(batches->empty() || batchSize == batches->back().imageFilePaths.size() ||
+           argBytes+imageFilePath.size() > g_exivBatchArgBytes)
+        {
+            batches->emplace_back();
+            argBytes = 0;
+        }
+        batches->back().imageFilePaths.push_back(imageFilePath);
+        argBytes += imageFilePath.size()+1;
     }
-    string coordText;
-    for(size_t gcpIndex = 0; inFile.good(); ++gcpIndex)
+    // the callbacks keep pointers into batches, it must not grow from now on
+    for(ExivBatch &batch : *batches)
     {
-        getline(inFile, coordText);
-        const size_t spaceIndex = coordText.find_first_of(' ');
-        if(string::npos == spaceIndex)
+        batch.exifs.assign(batch.imageFilePaths.size(), Exif());
+        // exiv2 pr DSC_1.JPG DSC_2.JPG ...
+        vector<string> arguments = {"pr"};
+        arguments.insert(arguments.end(), batch.imageFilePaths.begin(), batch.imageFilePaths.end());
+        ExivBatch *target = &batch;
+        batch.done = processEngine->Submit(exivBinPath, arguments, [target](const char *text)
         {
-            continue;
-        }
-        const double x = atof(coordText.substr(0, spaceIndex).c_str());
-        if(x < 0.0 || x > exif.width)
+            ParseExivBatchLine(text, target);
+        }).share();
+    }
+}
+
+// the size of the image at position of batch, zero when exiv2 printed no size
+void GetBatchedImageSize(const ExivBatch &batch, size_t position, Exif *exif)
+{
+    exif->width = batch.exifs[position].width;
+    exif->height = batch.exifs[position].height;
+}
+
+// the number at the start of [begin, end) as atof reads it, 0 when there is none
+double ParseCoordinate(const char *begin, const char *end)
+{
+    while(end != begin && isspace(static_cast<unsigned char>(*begin)))
+    {
+        ++begin;
+    }
+    double value = 0.0;
+    ParseDouble(begin, end, &value);
+    return value;
+}
+
+// the GCPs of imgCoordText in the image imageIndex, added to hits
+// imgCoordText is the output of XYZ2Im, "x y" per GCP
+void UpdateGcpImageHits(size_t gcpCount, const string &imgCoordText, uint32_t imageIndex,
+                        const Exif &exif, vector<GcpImageHit> *hits)
+{
+    const double width = static_cast<double>(exif.width);
+    const double height = static_cast<double>(exif.height);
+    const char *line = imgCoordText.data();
+    const char* const textEnd = line+imgCoordText.size();
+    for(uint32_t gcpIndex = 0; textEnd != line && gcpCount != gcpIndex; ++gcpIndex)
+    {
+        const char *lineEnd = static_cast<const char*>(memchr(line, '\n', textEnd-line));
+        if(nullptr == lineEnd)
         {
-            continue;
+            lineEnd = textEnd;
         }
-        const double y = atof(coordText.substr(spaceIndex+1).c_str());
-        if(y < 0.0 || y > exif.height)
+        const char *space = static_cast<const char*>(memchr(line, ' ', lineEnd-line));
+        if(nullptr != space)
         {
-            continue;
+            const double x = ParseCoordinate(line, lineEnd);
+            if(x >= 0.0 && x <= width)
+            {
+                const double y = ParseCoordinate(space+1, lineEnd);
+                if(y >= 0.0 && y <= height)
+                {
+                    hits->push_back({gcpIndex, imageIndex});
+                }
+            }
         }
-        (*targetMap)[gcpDat[gcpIndex].name].push_back(exif.name);
+        line = textEnd == lineEnd ? lineEnd : lineEnd+1;
     }
-    inFile.close();
 }
 
+// the name under which a child opens its descriptor fd
+string ChildFdPath(int fd)
+{
+    return "/proc/self/fd/"+std::to_string(fd);
+}
 
+// same as UpdateGcpImageHits, the GCPs (groundTable) are projected here instead of by XYZ2Im
+void ProjectGcpsNatively(const GroundPointTable &groundTable, const ConicOrientation &orientation,
+                         uint32_t imageIndex, const Exif &exif, vector<GcpImageHit> *hits)
+{
+    vector<uint32_t> insideIndices;
+    FindPointsInImage(orientation, groundTable,
+                      static_cast<double>(exif.width), static_cast<double>(exif.height),
+                      &insideIndices);
+    for(const uint32_t gcpIndex : insideIndices)
+    {
+        hits->push_back({gcpIndex, imageIndex});
+    }
+}
 
-bool MakeGcpToImagesMappingFile(const string &initPath,
-                                const path &datasetRoot, const path &oriDirPath,
+// the orientation of an image of a subdirectory is found by orientationDirs
+bool MakeGcpToImagesMappingFile(const path &datasetRoot,
+                                const map<string,OrientationDirectory> &orientationDirs,
                                 const set<string> &selectedImages,
+                                const map<string,FileKey> &imageFileKeys,
                                 const vector<GcpData> &gcpDat,
-                                const string &coordFilePath,
-                                const path &outputDir, bool pattern)
+                                const string &gcpCoordText,
+                                const OptionalArgs &args)
 {
+    const bool useMm3d = ProjectionEngine::Mm3d == args.engine;
     assert((false == gcpDat.empty()) && (false == selectedImages.empty()) && "No GCP data");
 
+    // every temporary file of the run goes there, so runs on the same dataset
+    // do not meet, it is removed on exit and on Ctrl-C
+    // no thread may be started before RemoveOnSignal
+    ScratchDirectory scratchDirectory;
+    if(false == scratchDirectory.Create(args.scratchPath))
+    {
+        cout<<"Cannot create a scratch directory"
+            <<(args.scratchPath.empty() ? string() : " in "+args.scratchPath)<<endl;
+        return false;
+    }
+    scratchDirectory.RemoveOnSignal();
+    SetScriptDirectory(scratchDirectory.Path());
+
+    // resolve the tools once, the workers start them by absolute path
 #if BOOST_OS_WINDOWS != 0
-    const string exivBinPath((path(initPath).parent_path()/"binaire-aux/windows/exiv2.exe").string());
+    const string exivBinDir((path(args.initPath).parent_path()/"binaire-aux/windows").string());
 #elif (BOOST_OS_LINUX!=0) || (BOOST_OS_MACOS!=0)
 	// assume the system already install exiv2    
-    const string exivBinPath("exiv2.exe").string());
+    const string exivBinDir;
 #endif
-    if(false == is_regular_file(exivBinPath))
+    // exiv2 is only needed for the formats ReadImageSizeFromHeader does not know
+    string exivBinPath;
+    if(false == ResolveBinaryPath(exivBinDir, "exiv2", &exivBinPath))
+    {
+        cout<<"Cannot find exiv2, only JPEG, TIFF and PNG images can be used"<<endl;
+    }
+    string mm3dBinPath;
+    if(useMm3d && false == ResolveBinaryPath(args.initPath, "mm3d", &mm3dBinPath))
     {
-        cout<<"Cannot find exiv2: "<<exivBinPath<<endl;
+        cout<<"Cannot find mm3d in "<<args.initPath<<" or PATH"<<endl;
         return false;
     }
-    // mm3d XYZ2Im "Ori-GcpInitOri/Orientation-DSC_6443.jpg.xml" coordinates.txt DSC_6443-GCP.txt
-    vector<string> arguments = {"XYZ2Im", "", coordFilePath, ""};
-    const auto callback = [](const char *text){cout<<text;};
-    Gcp2ImgsMapType gcp2ImgsMap;
-    error_code errorCode;
-    Exif exif;
-
-    for(const auto &imageFileName : selectedImages)
-    {
-        string &oriFilePath = arguments[1];
-        oriFilePath = "Orientation-";
-        oriFilePath.append(imageFileName);
-        oriFilePath.append(".xml");
-        oriFilePath = (oriDirPath/oriFilePath).string();
-
-        string &imgCoordFileName = arguments[3];
-        imgCoordFileName = imageFileName;
-        AddPostfix("-GCP", &imgCoordFileName);
-        imgCoordFileName.append(".txt");
-        imgCoordFileName = (datasetRoot/imgCoordFileName).string();
-        ProcessInvoke("", "mm3d", arguments, callback);
-        if(false == GetImageFileExif((datasetRoot/imageFileName).string(),
-                                     exivBinPath, &exif))
-        {
-            cout<<"Error in getting image EXIF: "<<(datasetRoot/imageFileName).string()<<endl;
+    // XYZ2Im does not touch the dataset directory: where the engine hands descriptors
+    // to its children, it reads the coordinates from a memfd and writes every result
+    // into a pipe, elsewhere or with Xyz2ImPipe=false both are files of a scratch directory
+    MemoryFile coordFile;
+    string coordFilePath;
+    if(useMm3d)
+    {
+        if(args.xyz2ImPipe && ProcessEngine::HasChildDescriptors() &&
+           coordFile.Create(g_coordFileName, gcpCoordText))
+        {
+            coordFilePath = ChildFdPath(g_childInputFd);
+        }
+        else if(WriteGcpsCoordToFile(scratchDirectory.Path(), gcpCoordText))
+        {
+            coordFilePath = (path(scratchDirectory.Path())/g_coordFileName).string();
+        }
+        else
+        {
+            return false;
+        }
+    }
+    const auto callback = [](const char *text)
+    {
+        lock_guard<mutex> lock(ConsoleMutex());
+        cout<<text;
+    };
+    const vector<string> images(selectedImages.begin(), selectedImages.end());
+    struct ImageJob
+    {
+        const OrientationDirectory *orientationDir;
+        string oriFilePath;
+        // only with the scratch directory
+        string imgCoordFilePath;
+        future<int> xyz2ImDone;
+        // what XYZ2Im wrote, ready with xyz2ImDone
+        string xyz2ImOutput;
+        // native engine, read with the image size
+        bool orientationRead;
+        ConicOrientation orientation;
+        // exif from the calibration, the size cache or the file header
+        bool exifKnown;
+        // the size is to be stored in the cache once known
+        bool fileKeyKnown;
+        bool toBeCached;
+        FileKey fileKey;
+        // exif from the exivBatch run of exiv2, the image is at exivBatchPosition
+        bool exifQueued;
+        size_t exivBatch;
+        size_t exivBatchPosition;
+        Exif exif;
+    };
+    vector<ImageJob> jobs(images.size());
+    // the images of a block share a few calibrations
+    CalibrationCache calibrationCache;
+    // sizes of the previous runs, the workers only look it up
+    ImageSizeCache sizeCache((datasetRoot/g_sizeCacheFileName).string());
+    if(args.sizeCache)
+    {
+        sizeCache.Load();
+    }
+    // the sizes MicMac already read for Tapioca/Tapas, in the Tmp-MM-Dir
+    // of the directory of each image
+    map<string, string> metadataFiles;
+    map<string, set<string>> imageNamesPerDir;
+    for(const auto &image : selectedImages)
+    {
+        const string imageDir(ImageDirectoryOf(image));
+        imageNamesPerDir[imageDir].insert(imageDir.empty() ? image : image.substr(imageDir.size()+1));
+    }
+    for(const auto &dirImages : imageNamesPerDir)
+    {
+        if(dirImages.first.empty())
+        {
+            ScanMicMacMetadata((datasetRoot/g_tmpMmDirName).string(), dirImages.second, &metadataFiles);
             continue;
         }
-        UpdateGcp2ImgsMap(gcpDat, imgCoordFileName, exif, &gcp2ImgsMap);
-        remove(path(imgCoordFileName), errorCode);
+        map<string, string> dirMetadataFiles;
+        ScanMicMacMetadata((datasetRoot/dirImages.first/g_tmpMmDirName).string(), dirImages.second,
+                           &dirMetadataFiles);
+        for(auto &metadataFile : dirMetadataFiles)
+        {
+            metadataFiles[dirImages.first+'/'+metadataFile.first] = std::move(metadataFile.second);
+        }
+    }
+    // float columns of every GCP for the native projection
+    GroundPointTable groundTable;
+    if(false == useMm3d)
+    {
+        vector<double> groundXyz;
+        groundXyz.reserve(3*gcpDat.size());
+        for(const auto &gcp : gcpDat)
+        {
+            groundXyz.push_back(gcp.x);
+            groundXyz.push_back(gcp.y);
+            groundXyz.push_back(gcp.z);
+        }
+        BuildGroundPointTable(groundXyz.data(), gcpDat.size(), &groundTable);
+    }
+    // every worker collects its own (GCP, image) hits, names are only used for the output
+    vector<vector<GcpImageHit>> workerHits(args.threadCount);
+    // XYZ2Im writes a line per GCP, the images it wrote nothing for make the run fail
+    std::atomic<size_t> xyz2ImFailureCount(0);
+    // filled by the engine, so it must outlive it
+    vector<ExivBatch> exivBatches;
+    {
+        // this thread queues every command, the engine keeps processCount
+        // children busy, XYZ2Im and exiv2 of one image run side by side
+        ProcessEngine processEngine(args.processCount);
+        for(size_t imageIndex = 0; images.size() != imageIndex; ++imageIndex)
+        {
+            const string imageFileName(path(images[imageIndex]).filename().string());
+            ImageJob &job = jobs[imageIndex];
+            job.orientationDir = &orientationDirs.at(ImageDirectoryOf(images[imageIndex]));
+            job.oriFilePath = "Orientation-";
+            job.oriFilePath.append(imageFileName);
+            job.oriFilePath.append(".xml");
+            job.oriFilePath = (job.orientationDir->oriDirPath/job.oriFilePath).string();
+            if(useMm3d && -1 != coordFile.Fd())
+            {
+                // mm3d XYZ2Im "Ori-GcpInitOri/Orientation-DSC_6443.jpg.xml" /proc/self/fd/4 /proc/self/fd/3
+                const vector<string> arguments = {"XYZ2Im", job.oriFilePath, coordFilePath,
+                                                  ChildFdPath(g_childResultFd)};
+                string *output = &job.xyz2ImOutput;
+                job.xyz2ImDone = processEngine.SubmitWithResult(mm3dBinPath, arguments, callback,
+                                                                coordFile.Fd(),
+                                                                [output](const char *data, size_t size)
+                {
+                    output->append(data, size);
+                });
+            }
+            else if(useMm3d)
+            {
+                // images of different directories may have the same name
+                job.imgCoordFilePath = std::to_string(imageIndex)+'-'+imageFileName;
+                AddPostfix("-GCP", &job.imgCoordFilePath);
+                job.imgCoordFilePath.append(".txt");
+                job.imgCoordFilePath = (path(scratchDirectory.Path())/job.imgCoordFilePath).string();
+                // mm3d XYZ2Im "Ori-GcpInitOri/Orientation-DSC_6443.jpg.xml" coordinates.txt 0-DSC_6443-GCP.txt
+                const vector<string> arguments = {"XYZ2Im", job.oriFilePath, coordFilePath,
+                                                  job.imgCoordFilePath};
+                job.xyz2ImDone = processEngine.Submit(mm3dBinPath, arguments, callback);
+            }
+        }
+        // while XYZ2Im runs, read the image sizes from the calibrations,
+        // the MicMac metadata, the size cache or the headers
+        ParallelFor(images.size(), args.threadCount, [&](size_t imageIndex, unsigned)
+        {
+            ImageJob &job = jobs[imageIndex];
+            job.orientationRead = false == useMm3d &&
+                                  ReadConicOrientation(job.oriFilePath,
+                                                       job.orientationDir->projectRoot.string(),
+                                                       &calibrationCache, &job.orientation);
+            job.exifKnown = false;
+            if(args.sizeFromCalib)
+            {
+                if(job.orientationRead)
+                {
+                    job.exif.width = job.orientation.calibration.imageSize[0];
+                    job.exif.height = job.orientation.calibration.imageSize[1];
+                    job.exifKnown = 0 != job.exif.width && 0 != job.exif.height;
+                }
+                else if(useMm3d)
+                {
+                    job.exifKnown = ReadOrientationImageSize(job.oriFilePath,
+                                                             job.orientationDir->projectRoot.string(),
+                                                             &calibrationCache,
+                                                             &job.exif.width, &job.exif.height);
+                }
+            }
+            if(false == job.exifKnown)
+            {
+                const auto metadataIter = metadataFiles.find(images[imageIndex]);
+                job.exifKnown = metadataFiles.end() != metadataIter &&
+                                ReadMicMacMetadataSize(metadataIter->second,
+                                                       &job.exif.width, &job.exif.height);
+            }
+            const string imageFilePath((datasetRoot/images[imageIndex]).string());
+            job.fileKeyKnown = false;
+            if(false == job.exifKnown && args.sizeCache)
+            {
+                // stat'ed by the directory scan, else stat it now
+                const auto keyIter = imageFileKeys.find(images[imageIndex]);
+                job.fileKeyKnown = imageFileKeys.end() != keyIter;
+                if(job.fileKeyKnown)
+                {
+                    job.fileKey = keyIter->second;
+                }
+                else
+                {
+                    job.fileKeyKnown = ReadFileKey(imageFilePath, &job.fileKey);
+                }
+            }
+            job.toBeCached = false;
+            if(job.fileKeyKnown)
+            {
+                job.exifKnown = sizeCache.Find(images[imageIndex], job.fileKey,
+                                               &job.exif.width, &job.exif.height);
+                job.toBeCached = false == job.exifKnown;
+            }
+            if(false == job.exifKnown)
+            {
+                job.exifKnown = ReadImageFileHeader(imageFilePath, &job.exif);
+            }
+        });
+        // exiv2 only for the other formats, many images per run
+        vector<string> exivImageFilePaths;
+        vector<size_t> exivJobIndices;
+        for(size_t imageIndex = 0; images.size() != imageIndex; ++imageIndex)
+        {
+            ImageJob &job = jobs[imageIndex];
+            const string imageFilePath((datasetRoot/images[imageIndex]).string());
+            job.exifQueued = false == job.exifKnown && false == exivBinPath.empty();
+            if(job.exifQueued)
+            {
+                exivImageFilePaths.push_back(imageFilePath);
+                exivJobIndices.push_back(imageIndex);
+            }
+        }
+        SubmitExivBatches(exivImageFilePaths, args.exivBatchSize, exivBinPath,
+                          &processEngine, &exivBatches);
+        for(size_t batchIndex = 0, jobIndex = 0; exivBatches.size() != batchIndex; ++batchIndex)
+        {
+            const size_t batchSize = exivBatches[batchIndex].imageFilePaths.size();
+            for(size_t position = 0; batchSize != position; ++position, ++jobIndex)
+            {
+                ImageJob &job = jobs[exivJobIndices[jobIndex]];
+                job.exivBatch = batchIndex;
+                job.exivBatchPosition = position;
+            }
+        }
+        // the workers only parse, in submission order
+        ParallelFor(images.size(), args.threadCount, [&](size_t imageIndex, unsigned workerIndex)
+        {
+            ImageJob &job = jobs[imageIndex];
+            int xyz2ImStatus = -1;
+            if(useMm3d)
+            {
+                try
+                {
+                    xyz2ImStatus = job.xyz2ImDone.get();
+                }
+                catch(...)
+                {}
+                if(false == job.imgCoordFilePath.empty())
+                {
+                    error_code errorCode;
+                    ReadWholeFile(job.imgCoordFilePath, &job.xyz2ImOutput);
+                    remove(path(job.imgCoordFilePath), errorCode);
+                }
+            }
+            if(job.exifQueued)
+            {
+                const ExivBatch &batch = exivBatches[job.exivBatch];
+                batch.done.wait();
+                GetBatchedImageSize(batch, job.exivBatchPosition, &job.exif);
+            }
+            if((false == job.exifKnown && false == job.exifQueued) ||
+               0 == job.exif.width || 0 == job.exif.height)
+            {
+                lock_guard<mutex> lock(ConsoleMutex());
+                cout<<"Error in getting image EXIF: "<<(datasetRoot/images[imageIndex]).string()<<endl;
+            }
+            else if(useMm3d && job.xyz2ImOutput.empty())
+            {
+                ++xyz2ImFailureCount;
+                lock_guard<mutex> lock(ConsoleMutex());
+                if(0 != xyz2ImStatus)
+                {
+                    cout<<"XYZ2Im failed (status "<<xyz2ImStatus<<") for: "<<job.oriFilePath<<endl;
+                }
+                else
+                {
+                    // exited fine but wrote nothing, e.g. it could not write into the pipe
+                    cout<<"XYZ2Im wrote no image coordinates for: "<<job.oriFilePath
+                        <<(job.imgCoordFilePath.empty() ? ", try Xyz2ImPipe=false" : "")<<endl;
+                }
+            }
+            else if(useMm3d)
+            {
+                UpdateGcpImageHits(gcpDat.size(), job.xyz2ImOutput, static_cast<uint32_t>(imageIndex),
+                                   job.exif, &workerHits[workerIndex]);
+                // the text of every image is not kept until the end
+                string().swap(job.xyz2ImOutput);
+            }
+            else if(job.orientationRead)
+            {
+                ProjectGcpsNatively(groundTable, job.orientation, static_cast<uint32_t>(imageIndex),
+                                    job.exif, &workerHits[workerIndex]);
+            }
+        });
+    }
+    if(args.sizeCache)
+    {
+        for(size_t imageIndex = 0; images.size() != imageIndex; ++imageIndex)
+        {
+            const ImageJob &job = jobs[imageIndex];
+            if(job.toBeCached && (job.exifKnown || job.exifQueued) &&
+               0 != job.exif.width && 0 != job.exif.height)
+            {
+                sizeCache.Insert(images[imageIndex], job.fileKey, job.exif.width, job.exif.height);
+            }
+        }
+        if(false == sizeCache.Save())
+        {
+            cout<<"Cannot write the image size cache in "<<datasetRoot.string()<<endl;
+        }
+    }
+
+    // the images are visited in name order when running serially, the rows
+    // keep the same order so the output does not depend on Threads
+    SparseRows gcpImages;
+    BuildSparseRows(workerHits, gcpDat.size(), images.size(), &gcpImages);
+    vector<vector<GcpImageHit>>().swap(workerHits);
+    if(0 != xyz2ImFailureCount)
+    {
+        cout<<endl<<"No image coordinates from XYZ2Im for "<<xyz2ImFailureCount
+            <<" image(s), the output misses their GCPs"<<endl;
+        // what the other images gave is still written
+        if(false == gcpImages.columns.empty())
+        {
+            WriteGcp2ImgsToFile(gcpDat, images, gcpImages, datasetRoot/args.outputDirName, args.pattern);
+        }
+        return false;
     }
-    remove(path(coordFilePath), errorCode);
     // write result
-    return WriteGcp2ImgsToFile(gcp2ImgsMap, outputDir, pattern);
+    return WriteGcp2ImgsToFile(gcpDat, images, gcpImages, datasetRoot/args.outputDirName, args.pattern);
 }
-
 }
 
 int main(int argc,char **argv)
@@ -577,36 +1598,55 @@ int main(int argc,char **argv)
     const path datasetRoot = path(allImagePattern).parent_path();
     string oriDirName(argv[g_oriArgIndex]);
     AddOriPrefixIfNotExisted(&oriDirName);
-    const path oriDirPath(datasetRoot/oriDirName);
     const path gcpFilePath(datasetRoot/argv[g_gcpFileArgIndex]);
-    if(false == ValidateArgumentsAndPrompt(oriDirPath, gcpFilePath))
+    if(false == ValidateArgumentsAndPrompt(gcpFilePath))
     {
         // something goes wrong
         return 1;
     }
+    // default setting
+    OptionalArgs args;
+    args.initPath = initial_path().string();
+    args.threadCount = args.processCount = DefaultThreadCount();
+    FetchOptionalArg(argc, argv, &args);
     set<string> selectedImages;
-    if(false == FileterImagesByPattern(allImagePattern, &selectedImages))
+    map<string,FileKey> imageFileKeys;
+    map<string,OrientationDirectory> orientationDirs;
+    // the scheduler that gives the list already knows the images, nothing is scanned
+    const bool imagesSelected = args.imageListPath.empty() ?
+                                FileterImagesByPattern(allImagePattern, args.imageDirs, args.recursive,
+                                                       args.threadCount, &selectedImages, &imageFileKeys) :
+                                ReadImageList(datasetRoot, args.imageListPath, &selectedImages);
+    if(false == imagesSelected ||
+       false == ResolveOrientationDirectories(datasetRoot, oriDirName, &selectedImages, &orientationDirs))
     {
         // something goes wrong
         return 1;
     }
     vector<GcpData> gcpDat;
-    if(false == FetchAllGcps(gcpFilePath.string().c_str(), &gcpDat))
+    // the XYZ2Im input, kept in the cache with the GCPs
+    string gcpCoordText;
+    GcpCache gcpCache(gcpFilePath.string(),
+                      (gcpFilePath.parent_path()/(g_gcpCachePrefix+gcpFilePath.filename().string()+
+                                                  g_gcpCacheSuffix)).string());
+    if(false == args.gcpCache || false == gcpCache.Load(&gcpDat, &gcpCoordText))
     {
-        // something goes wrong
-        return 1;
-    }
-    if(false == WriteGcpsCoordToFile(datasetRoot, gcpDat))
-    {
-        // something goes wrong
-        return 1;
+        ContentHasher contentHasher;
+        if(false == FetchAllGcps(gcpFilePath, args.gcpParser, args.threadCount, &gcpDat,
+                                 args.gcpCache ? &contentHasher : nullptr))
+        {
+            // something goes wrong
+            return 1;
+        }
+        if(args.gcpCache || ProjectionEngine::Mm3d == args.engine)
+        {
+            gcpCoordText = FormatGcpsCoord(gcpDat);
+        }
+        if(args.gcpCache && false == gcpCache.Save(gcpDat, gcpCoordText, contentHasher.Value()))
+        {
+            cout<<"Cannot write the GCP cache beside "<<gcpFilePath.string()<<endl;
+        }
     }
-    // default setting
-    string outputDirName("GCP-IMG"), initPath(initial_path().string());
-    bool pattern = true;
-    FetchOptionalArg(argc, argv, &outputDirName, &initPath, &pattern);
-    const string coordFilePath((datasetRoot/g_coordFileName).string());
-    return MakeGcpToImagesMappingFile(initPath, datasetRoot, oriDirPath,
-                                      selectedImages, gcpDat, coordFilePath,
-                                      datasetRoot/outputDirName, pattern) ? 0 : 1;
+    return MakeGcpToImagesMappingFile(datasetRoot, orientationDirs, selectedImages, imageFileKeys,
+                                      gcpDat, gcpCoordText, args) ? 0 : 1;
 }
@@ -0,0 +1,238 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: GcpCache
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "GcpCache.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "MappedFile.h"
+#include "FileContent.h"
+
+using std::string;
+using std::vector;
+
+namespace
+{
+// file layout, in the byte order of the machine that wrote it:
+// header {magic, version, GCP count, control file size, mtime seconds,
+//         mtime nanoseconds, inode, content hash, name bytes, text bytes}
+// then the columns x[count], y[count], z[count] (double),
+// name ends[count] (uint64_t, from the start of the names),
+// the names and the coordinates text, each section 8 byte aligned
+// the sizes of the header must add up to the file size and every name end
+// must stay in the names, nothing else is checked: the file is only written
+// by ReplaceFileContent, never seen half written
+// bump the version when the GCPs read from a file may change
+constexpr uint32_t g_cacheMagic = 0x43504347; // "GCPC"
+constexpr uint32_t g_cacheVersion = 2;
+constexpr size_t g_headerSize = 72;
+constexpr uint64_t g_hashMultiplier = 0xff51afd7ed558ccdULL;
+
+size_t AlignedSize(size_t size)
+{
+    return (size+7)/8*8;
+}
+
+// only on a key change: a copied or touched control file
+bool HashFile(const string &filePath, uint64_t *hash)
+{
+    MappedFile content;
+    if(false == content.Open(filePath))
+    {
+        return false;
+    }
+    ContentHasher hasher;
+    hasher.Update(content.Data(), content.Size());
+    *hash = hasher.Value();
+    return true;
+}
+}
+
+// a hash of the content, only to tell that it changed, a word at a time
+ContentHasher::ContentHasher()
+    : m_hash(0x9e3779b97f4a7c15ULL), m_size(0), m_word(), m_wordSize(0)
+{
+}
+
+void ContentHasher::Update(const char *data, size_t size)
+{
+    m_size += size;
+    if(0 != m_wordSize)
+    {
+        const size_t count = std::min(size, sizeof(m_word)-m_wordSize);
+        memcpy(m_word+m_wordSize, data, count);
+        m_wordSize += count;
+        data += count;
+        size -= count;
+        if(sizeof(m_word) != m_wordSize)
+        {
+            return;
+        }
+        m_hash = (m_hash^ReadValue<uint64_t>(m_word))*g_hashMultiplier;
+        m_hash ^= m_hash >> 29;
+        m_wordSize = 0;
+    }
+    for(; size >= 8; data += 8, size -= 8)
+    {
+        m_hash = (m_hash^ReadValue<uint64_t>(data))*g_hashMultiplier;
+        m_hash ^= m_hash >> 29;
+    }
+    memcpy(m_word, data, size);
+    m_wordSize = size;
+}
+
+uint64_t ContentHasher::Value() const
+{
+    uint64_t tail = 0;
+    memcpy(&tail, m_word, m_wordSize);
+    uint64_t hash = (m_hash^tail)*g_hashMultiplier;
+    hash = (hash^m_size)*g_hashMultiplier;
+    hash ^= hash >> 32;
+    hash *= g_hashMultiplier;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+GcpCache::GcpCache(const string &gcpFilePath, const string &cacheFilePath)
+    : m_gcpFilePath(gcpFilePath), m_cacheFilePath(cacheFilePath), m_keyKnown(false), m_key()
+{
+}
+
+bool GcpCache::Load(vector<GcpData> *gcps, string *coordText)
+{
+    gcps->clear();
+    coordText->clear();
+    m_keyKnown = ReadFileKey(m_gcpFilePath, &m_key);
+    MappedFile cache;
+    if(false == m_keyKnown || false == cache.Open(m_cacheFilePath) || cache.Size() < g_headerSize)
+    {
+        return false;
+    }
+    const char *bytes = cache.Data();
+    if(g_cacheMagic != ReadValue<uint32_t>(bytes) || g_cacheVersion != ReadValue<uint32_t>(bytes+4))
+    {
+        return false;
+    }
+    const uint64_t gcpCount = ReadValue<uint64_t>(bytes+8);
+    FileKey key;
+    key.fileSize = ReadValue<uint64_t>(bytes+16);
+    key.mtimeSeconds = ReadValue<int64_t>(bytes+24);
+    key.mtimeNanoseconds = ReadValue<int64_t>(bytes+32);
+    key.inode = ReadValue<uint64_t>(bytes+40);
+    const uint64_t contentHash = ReadValue<uint64_t>(bytes+48);
+    const uint64_t nameBytes = ReadValue<uint64_t>(bytes+56);
+    const uint64_t textBytes = ReadValue<uint64_t>(bytes+64);
+    // 32 bytes per GCP at least, this bounds every size below
+    const size_t available = cache.Size()-g_headerSize;
+    if(gcpCount > available/32 || nameBytes > available || textBytes > available ||
+       g_headerSize+gcpCount*32+AlignedSize(nameBytes)+AlignedSize(textBytes) != cache.Size())
+    {
+        return false;
+    }
+    // the content is hashed only when the key does not tell it is the same
+    uint64_t sourceHash = contentHash;
+    const bool keyChanged = key != m_key;
+    if(keyChanged && (false == HashFile(m_gcpFilePath, &sourceHash) || sourceHash != contentHash))
+    {
+        return false;
+    }
+
+    const char *xColumn = bytes+g_headerSize;
+    const char *yColumn = xColumn+gcpCount*8;
+    const char *zColumn = yColumn+gcpCount*8;
+    const char *nameEnds = zColumn+gcpCount*8;
+    const char *names = nameEnds+gcpCount*8;
+    // GcpData owns its name for the whole run, so the names are copied out of
+    // the mapping, most are short enough for the string's own buffer
+    gcps->resize(gcpCount);
+    uint64_t nameBegin = 0;
+    for(size_t gcpIndex = 0; gcpCount != gcpIndex; ++gcpIndex)
+    {
+        const uint64_t nameEnd = ReadValue<uint64_t>(nameEnds+gcpIndex*8);
+        if(nameEnd < nameBegin || nameEnd > nameBytes)
+        {
+            gcps->clear();
+            return false;
+        }
+        GcpData &gcp = (*gcps)[gcpIndex];
+        gcp.name.assign(names+nameBegin, names+nameEnd);
+        gcp.x = ReadValue<double>(xColumn+gcpIndex*8);
+        gcp.y = ReadValue<double>(yColumn+gcpIndex*8);
+        gcp.z = ReadValue<double>(zColumn+gcpIndex*8);
+        nameBegin = nameEnd;
+    }
+    coordText->assign(names+AlignedSize(nameBytes), textBytes);
+    if(keyChanged)
+    {
+        // same content under another key, next run need not hash it
+        Write(*gcps, *coordText, contentHash);
+    }
+    return true;
+}
+
+bool GcpCache::Save(const vector<GcpData> &gcps, const string &coordText, uint64_t contentHash)
+{
+    // the key of Load was read before the GCPs, the same key now tells
+    // the file did not change while it was parsed
+    FileKey key;
+    if(false == m_keyKnown || false == ReadFileKey(m_gcpFilePath, &key) || key != m_key)
+    {
+        return false;
+    }
+    return Write(gcps, coordText, contentHash);
+}
+
+bool GcpCache::Write(const vector<GcpData> &gcps, const string &coordText, uint64_t contentHash)
+{
+    uint64_t nameBytes = 0;
+    for(const auto &gcp : gcps)
+    {
+        nameBytes += gcp.name.size();
+    }
+    vector<char> content;
+    content.reserve(g_headerSize+gcps.size()*32+AlignedSize(nameBytes)+AlignedSize(coordText.size()));
+    AppendValue<uint32_t>(g_cacheMagic, &content);
+    AppendValue<uint32_t>(g_cacheVersion, &content);
+    AppendValue<uint64_t>(gcps.size(), &content);
+    AppendValue<uint64_t>(m_key.fileSize, &content);
+    AppendValue<int64_t>(m_key.mtimeSeconds, &content);
+    AppendValue<int64_t>(m_key.mtimeNanoseconds, &content);
+    AppendValue<uint64_t>(m_key.inode, &content);
+    AppendValue<uint64_t>(contentHash, &content);
+    AppendValue<uint64_t>(nameBytes, &content);
+    AppendValue<uint64_t>(coordText.size(), &content);
+    for(const auto &gcp : gcps)
+    {
+        AppendValue<double>(gcp.x, &content);
+    }
+    for(const auto &gcp : gcps)
+    {
+        AppendValue<double>(gcp.y, &content);
+    }
+    for(const auto &gcp : gcps)
+    {
+        AppendValue<double>(gcp.z, &content);
+    }
+    uint64_t nameEnd = 0;
+    for(const auto &gcp : gcps)
+    {
+        nameEnd += gcp.name.size();
+        AppendValue<uint64_t>(nameEnd, &content);
+    }
+    for(const auto &gcp : gcps)
+    {
+        content.insert(content.end(), gcp.name.begin(), gcp.name.end());
+    }
+    content.resize(AlignedSize(content.size()), '\0');
+    content.insert(content.end(), coordText.begin(), coordText.end());
+    content.resize(AlignedSize(content.size()), '\0');
+
+    return ReplaceFileContent(m_cacheFilePath, content);
+}
@@ -0,0 +1,71 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: GcpCache
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_GCPCACHE_H_
+#define COMMON_GCPCACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GcpReader.h"
+#include "FileKey.h"
+
+// the hash a GcpCache keeps of the control file content, fed with the bytes
+// as the parser reads them, so the file is not read again to save the cache
+class ContentHasher
+{
+public:
+    ContentHasher();
+
+    void Update(const char *data, size_t size);
+    // the hash of every byte given so far
+    uint64_t Value() const;
+
+private:
+    uint64_t m_hash;
+    uint64_t m_size;
+    // the bytes of a word not complete yet
+    char m_word[8];
+    size_t m_wordSize;
+};
+
+// the GCPs of a control file and their XYZ2Im coordinates text, stored in
+// a binary file beside it by a previous run: names in one string table and
+// x, y, z in packed columns, mapped when loaded, no XML to parse
+// the cache holds the size, mtime and inode of the control file and a hash
+// of its content: the same key trusts the cache without hashing anything,
+// another key with the same content (a copy, a touch) refreshes it, another
+// content makes it stale
+class GcpCache
+{
+public:
+    GcpCache(const std::string &gcpFilePath, const std::string &cacheFilePath);
+
+    // false when the cache is missing, unreadable or stale
+    bool Load(std::vector<GcpData> *gcps, std::string *coordText);
+    // the GCPs read from the control file since Load, contentHash is the
+    // ContentHasher value of the bytes they were parsed from, nothing is
+    // written when the control file changed meanwhile, the new content is
+    // written beside the cache then renamed over it
+    bool Save(const std::vector<GcpData> &gcps, const std::string &coordText,
+              uint64_t contentHash);
+
+private:
+    bool Write(const std::vector<GcpData> &gcps, const std::string &coordText,
+               uint64_t contentHash);
+
+    std::string m_gcpFilePath;
+    std::string m_cacheFilePath;
+    // the control file as Load saw it
+    bool m_keyKnown;
+    FileKey m_key;
+};
+
+#endif // COMMON_GCPCACHE_H_
@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: BuildSparseRows
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "GcpImageHits.h"
+
+using std::vector;
+
+namespace
+{
+// offsets of rowCount rows from the number of columns of each row
+// counts holds rowCount+1 values, the count of the row r at counts[r+1]
+void CountsToOffsets(vector<size_t> *counts)
+{
+    for(size_t row = 1; counts->size() != row; ++row)
+    {
+        (*counts)[row] += (*counts)[row-1];
+    }
+}
+}
+
+void BuildSparseRows(const vector<vector<GcpImageHit>> &workerHits,
+                     size_t gcpCount, size_t imageCount, SparseRows *gcpImages)
+{
+    // first pass: the GCPs of each image, a counting sort by image
+    SparseRows imageGcps;
+    imageGcps.offsets.assign(imageCount+1, 0);
+    gcpImages->offsets.assign(gcpCount+1, 0);
+    size_t hitCount = 0;
+    for(const auto &hits : workerHits)
+    {
+        hitCount += hits.size();
+        for(const auto &hit : hits)
+        {
+            ++imageGcps.offsets[hit.imageIndex+1];
+            ++gcpImages->offsets[hit.gcpIndex+1];
+        }
+    }
+    CountsToOffsets(&imageGcps.offsets);
+    CountsToOffsets(&gcpImages->offsets);
+    imageGcps.columns.resize(hitCount);
+    // the next free column of each row
+    vector<size_t> cursors(imageGcps.offsets.begin(), imageGcps.offsets.end()-1);
+    for(const auto &hits : workerHits)
+    {
+        for(const auto &hit : hits)
+        {
+            imageGcps.columns[cursors[hit.imageIndex]++] = hit.gcpIndex;
+        }
+    }
+    // second pass: a counting sort by GCP visiting the images in increasing
+    // order, so every GCP row comes out sorted
+    gcpImages->columns.resize(hitCount);
+    cursors.assign(gcpImages->offsets.begin(), gcpImages->offsets.end()-1);
+    for(size_t imageIndex = 0; imageCount != imageIndex; ++imageIndex)
+    {
+        for(size_t column = imageGcps.offsets[imageIndex]; imageGcps.offsets[imageIndex+1] != column;
+            ++column)
+        {
+            gcpImages->columns[cursors[imageGcps.columns[column]]++] = static_cast<uint32_t>(imageIndex);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: BuildSparseRows
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_GCPIMAGEHITS_H_
+#define COMMON_GCPIMAGEHITS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the GCP gcpIndex projects into the image imageIndex
+struct GcpImageHit
+{
+    uint32_t gcpIndex;
+    uint32_t imageIndex;
+};
+
+// compressed sparse rows: the columns of the row r are
+// columns[offsets[r]] to columns[offsets[r+1]-1]
+struct SparseRows
+{
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> columns;
+};
+
+// the images of each GCP, in increasing order, from the hits of every
+// worker in any order: a counting sort by image, then a stable one by GCP,
+// O(hits+GCPs+images), no comparison sort
+void BuildSparseRows(const std::vector<std::vector<GcpImageHit>> &workerHits,
+                     size_t gcpCount, size_t imageCount, SparseRows *gcpImages);
+
+#endif // COMMON_GCPIMAGEHITS_H_
@@ -0,0 +1,298 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: GcpPlyReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "GcpPlyReader.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace
+{
+// the words of a header line
+void SplitWords(const char *line, size_t size, vector<string> *words)
+{
+    words->clear();
+    const char* const end = line+size;
+    while(end != line)
+    {
+        if(' ' == *line || '\t' == *line)
+        {
+            ++line;
+            continue;
+        }
+        const char *wordEnd = line;
+        while(end != wordEnd && ' ' != *wordEnd && '\t' != *wordEnd)
+        {
+            ++wordEnd;
+        }
+        words->emplace_back(line, wordEnd);
+        line = wordEnd;
+    }
+}
+
+uint64_t LoadLittleEndian(const unsigned char *bytes, size_t size)
+{
+    uint64_t value = 0;
+    while(0 != size)
+    {
+        --size;
+        value = value << 8 | bytes[size];
+    }
+    return value;
+}
+}
+
+GcpPlyReader::GcpPlyReader(ByteSource *source)
+    : m_input(source), m_headerRead(false), m_skippedSize(0), m_vertexCount(0),
+      m_vertexIndex(0), m_vertexSize(0), m_coordinates(), m_good(true)
+{}
+
+bool GcpPlyReader::Good() const
+{
+    return m_good;
+}
+
+bool GcpPlyReader::Fail(const char *message)
+{
+    cout<<endl<<"Invalid GCP file: "<<message<<endl;
+    m_good = false;
+    return false;
+}
+
+bool GcpPlyReader::ReadHeader()
+{
+    const char *line = nullptr;
+    size_t lineSize = 0;
+    if(false == m_input.ReadLine(&line, &lineSize) || 3 != lineSize || 0 != memcmp(line, "ply", 3))
+    {
+        return Fail("not a PLY file");
+    }
+    static const char* const coordinateNames[] = {"x", "y", "z"};
+    static const struct
+    {
+        const char *name;
+        ScalarType type;
+        size_t size;
+    } scalarTypes[] = {{"char", ScalarType::Int8, 1}, {"int8", ScalarType::Int8, 1},
+                       {"uchar", ScalarType::UInt8, 1}, {"uint8", ScalarType::UInt8, 1},
+                       {"short", ScalarType::Int16, 2}, {"int16", ScalarType::Int16, 2},
+                       {"ushort", ScalarType::UInt16, 2}, {"uint16", ScalarType::UInt16, 2},
+                       {"int", ScalarType::Int32, 4}, {"int32", ScalarType::Int32, 4},
+                       {"uint", ScalarType::UInt32, 4}, {"uint32", ScalarType::UInt32, 4},
+                       {"float", ScalarType::Float32, 4}, {"float32", ScalarType::Float32, 4},
+                       {"double", ScalarType::Float64, 8}, {"float64", ScalarType::Float64, 8}};
+    bool coordinateFound[3] = {false, false, false};
+    bool formatRead = false;
+    bool vertexRead = false;
+    // the element being described
+    bool inElement = false;
+    bool isVertex = false;
+    bool hasList = false;
+    size_t elementCount = 0;
+    size_t elementSize = 0;
+    vector<string> words;
+    while(true)
+    {
+        if(false == m_input.ReadLine(&line, &lineSize))
+        {
+            return Fail("unexpected end of PLY header");
+        }
+        SplitWords(line, lineSize, &words);
+        if(words.empty() || "comment" == words[0] || "obj_info" == words[0])
+        {
+            continue;
+        }
+        const bool headerEnd = "end_header" == words[0];
+        if(headerEnd || "element" == words[0])
+        {
+            // the element described so far is complete
+            if(inElement && isVertex)
+            {
+                m_vertexCount = elementCount;
+                m_vertexSize = elementSize;
+                vertexRead = true;
+            }
+            else if(inElement && false == vertexRead)
+            {
+                if(hasList)
+                {
+                    return Fail("PLY elements with a list before the vertices are not supported");
+                }
+                if(0 != elementSize &&
+                   elementCount > (std::numeric_limits<size_t>::max()-m_skippedSize)/elementSize)
+                {
+                    return Fail("PLY element too large");
+                }
+                m_skippedSize += elementCount*elementSize;
+            }
+            if(headerEnd)
+            {
+                break;
+            }
+            if(3 != words.size())
+            {
+                return Fail("invalid PLY element line");
+            }
+            char *countEnd = nullptr;
+            const unsigned long long count = strtoull(words[2].c_str(), &countEnd, 10);
+            if('\0' != *countEnd || '-' == words[2][0])
+            {
+                return Fail("invalid PLY element count");
+            }
+            inElement = true;
+            isVertex = "vertex" == words[1] && false == vertexRead;
+            hasList = false;
+            elementCount = static_cast<size_t>(count);
+            elementSize = 0;
+        }
+        else if("format" == words[0])
+        {
+            if(words.size() < 2 || "binary_little_endian" != words[1])
+            {
+                return Fail("only binary_little_endian PLY files are supported");
+            }
+            formatRead = true;
+        }
+        else if("property" == words[0])
+        {
+            if(false == inElement || words.size() < 3)
+            {
+                return Fail("invalid PLY property line");
+            }
+            if("list" == words[1])
+            {
+                if(isVertex)
+                {
+                    return Fail("PLY vertices with a list property are not supported");
+                }
+                hasList = true;
+                continue;
+            }
+            const auto *scalarType = std::find_if(std::begin(scalarTypes), std::end(scalarTypes),
+                                                  [&words](decltype(scalarTypes[0]) candidate)
+                                                  {return candidate.name == words[1];});
+            if(std::end(scalarTypes) == scalarType)
+            {
+                return Fail("unknown PLY property type");
+            }
+            for(size_t index = 0; isVertex && 3 != index; ++index)
+            {
+                if(coordinateNames[index] == words[2])
+                {
+                    m_coordinates[index].type = scalarType->type;
+                    m_coordinates[index].offset = elementSize;
+                    coordinateFound[index] = true;
+                }
+            }
+            elementSize += scalarType->size;
+        }
+        else
+        {
+            return Fail("unknown PLY header line");
+        }
+    }
+    if(false == formatRead)
+    {
+        return Fail("PLY format line missing");
+    }
+    if(false == vertexRead || false == coordinateFound[0] ||
+       false == coordinateFound[1] || false == coordinateFound[2])
+    {
+        return Fail("PLY file without x, y and z vertex properties");
+    }
+    return true;
+}
+
+double GcpPlyReader::ReadProperty(const unsigned char *vertex, const Property &property) const
+{
+    const unsigned char *bytes = vertex+property.offset;
+    switch(property.type)
+    {
+    case ScalarType::Int8:
+        return static_cast<int8_t>(bytes[0]);
+    case ScalarType::UInt8:
+        return bytes[0];
+    case ScalarType::Int16:
+        return static_cast<int16_t>(static_cast<uint16_t>(LoadLittleEndian(bytes, 2)));
+    case ScalarType::UInt16:
+        return static_cast<uint16_t>(LoadLittleEndian(bytes, 2));
+    case ScalarType::Int32:
+        return static_cast<int32_t>(static_cast<uint32_t>(LoadLittleEndian(bytes, 4)));
+    case ScalarType::UInt32:
+        return static_cast<uint32_t>(LoadLittleEndian(bytes, 4));
+    case ScalarType::Float32:
+    {
+        const uint32_t raw = static_cast<uint32_t>(LoadLittleEndian(bytes, 4));
+        float value;
+        memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+    default:
+    {
+        const uint64_t raw = LoadLittleEndian(bytes, 8);
+        double value;
+        memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+    }
+}
+
+bool GcpPlyReader::Next(GcpData *gcp)
+{
+    if(false == m_good)
+    {
+        return false;
+    }
+    if(false == m_headerRead)
+    {
+        m_headerRead = true;
+        if(false == ReadHeader())
+        {
+            return false;
+        }
+        while(0 != m_skippedSize)
+        {
+            if(false == m_input.Ensure(1))
+            {
+                return Fail("unexpected end of PLY data");
+            }
+            const size_t skipped = std::min(m_skippedSize, m_input.Size());
+            m_input.Consume(skipped);
+            m_skippedSize -= skipped;
+        }
+    }
+    if(m_vertexCount == m_vertexIndex)
+    {
+        return false;
+    }
+    if(false == m_input.Ensure(m_vertexSize))
+    {
+        return Fail("unexpected end of PLY data");
+    }
+    const unsigned char *vertex = reinterpret_cast<const unsigned char*>(m_input.Data());
+    gcp->x = ReadProperty(vertex, m_coordinates[0]);
+    gcp->y = ReadProperty(vertex, m_coordinates[1]);
+    gcp->z = ReadProperty(vertex, m_coordinates[2]);
+    gcp->name = std::to_string(m_vertexIndex);
+    m_input.Consume(m_vertexSize);
+    ++m_vertexIndex;
+    return true;
+}
@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: GcpPlyReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_GCPPLYREADER_H_
+#define COMMON_GCPPLYREADER_H_
+
+#include <cstddef>
+
+#include "GcpReader.h"
+
+// GCPs as the vertices of a binary little endian PLY file, named by their
+// index: "0", "1", ... the x, y and z properties may be of any scalar type,
+// the other properties are skipped, and so are the elements before "vertex"
+// as long as they have no list property, those after it are not read
+class GcpPlyReader : public GcpReader
+{
+public:
+    explicit GcpPlyReader(ByteSource *source);
+
+    bool Next(GcpData *gcp) override;
+    bool Good() const override;
+
+private:
+    enum class ScalarType
+    {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Float32,
+        Float64
+    };
+    struct Property
+    {
+        ScalarType type;
+        // from the start of the vertex
+        size_t offset;
+    };
+
+    bool ReadHeader();
+    double ReadProperty(const unsigned char *vertex, const Property &property) const;
+    bool Fail(const char *message);
+
+    SourceBuffer m_input;
+    bool m_headerRead;
+    // bytes of the elements before the vertices
+    size_t m_skippedSize;
+    size_t m_vertexCount;
+    size_t m_vertexIndex;
+    size_t m_vertexSize;
+    Property m_coordinates[3];
+    bool m_good;
+};
+
+#endif // COMMON_GCPPLYREADER_H_
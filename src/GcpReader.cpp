@@ -0,0 +1,885 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: GcpStreamReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "GcpReader.h"
+
+#include "ParallelFor.h"
+#include "NumberParser.h"
+#include "GcpTextReader.h"
+#include "GcpPlyReader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::deque;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::condition_variable;
+
+namespace
+{
+// read by blocks of g_readBlockSize, at most g_readAheadBlocks waiting
+constexpr size_t g_readBlockSize = 1 << 20;
+constexpr size_t g_readAheadBlocks = 4;
+// what GcpStreamReader asks its source at once
+constexpr size_t g_parseReadSize = 64*1024;
+// ReadGcpsInParallel does not cut smaller parts
+constexpr size_t g_minPartSize = 1 << 20;
+
+class ReadAheadFile : public ByteSource
+{
+public:
+    explicit ReadAheadFile(FILE *file)
+        : m_file(file), m_currentOffset(0), m_ended(false), m_stopping(false)
+    {
+        m_reader = thread(&ReadAheadFile::ReadBlocks, this);
+    }
+    ~ReadAheadFile()
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_changed.notify_all();
+        m_reader.join();
+        fclose(m_file);
+    }
+
+    size_t Read(char *buffer, size_t size) override
+    {
+        if(m_current.size() == m_currentOffset)
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_changed.wait(lock, [this]{return m_ended || false == m_blocks.empty();});
+            if(m_blocks.empty())
+            {
+                return 0;
+            }
+            m_current = std::move(m_blocks.front());
+            m_blocks.pop_front();
+            m_currentOffset = 0;
+            lock.unlock();
+            m_changed.notify_all();
+        }
+        const size_t byteCopied = std::min(size, m_current.size()-m_currentOffset);
+        memcpy(buffer, m_current.data()+m_currentOffset, byteCopied);
+        m_currentOffset += byteCopied;
+        return byteCopied;
+    }
+
+private:
+    void ReadBlocks()
+    {
+        while(true)
+        {
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_changed.wait(lock, [this]{return m_stopping || m_blocks.size() < g_readAheadBlocks;});
+                if(m_stopping)
+                {
+                    return;
+                }
+            }
+            vector<char> block(g_readBlockSize);
+            block.resize(fread(block.data(), 1, block.size(), m_file));
+            {
+                lock_guard<mutex> lock(m_mutex);
+                if(block.empty())
+                {
+                    m_ended = true;
+                }
+                else
+                {
+                    m_blocks.push_back(std::move(block));
+                }
+            }
+            m_changed.notify_all();
+            if(m_ended)
+            {
+                return;
+            }
+        }
+    }
+
+    FILE *m_file;
+    // only used by the parsing thread
+    vector<char> m_current;
+    size_t m_currentOffset;
+
+    mutex m_mutex;
+    condition_variable m_changed;
+    deque<vector<char>> m_blocks;
+    bool m_ended;
+    bool m_stopping;
+    thread m_reader;
+};
+
+class MemorySource : public ByteSource
+{
+public:
+    MemorySource(const char *data, size_t size)
+        : m_data(data), m_remaining(size)
+    {}
+
+    size_t Read(char *buffer, size_t size) override
+    {
+        const size_t byteCopied = std::min(size, m_remaining);
+        memcpy(buffer, m_data, byteCopied);
+        m_data += byteCopied;
+        m_remaining -= byteCopied;
+        return byteCopied;
+    }
+
+private:
+    const char *m_data;
+    size_t m_remaining;
+};
+
+bool IsSpace(char character)
+{
+    return ' ' == character || '\t' == character || '\n' == character || '\r' == character;
+}
+
+// the predefined entities and the character references below 256,
+// the others are left as they are
+void DecodeEntities(string *text)
+{
+    if(string::npos == text->find('&'))
+    {
+        return;
+    }
+    static const struct
+    {
+        const char *name;
+        char character;
+    } entities[] = {{"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'}, {"&quot;", '"'}, {"&apos;", '\''}};
+    string decoded;
+    decoded.reserve(text->size());
+    for(size_t index = 0; text->size() != index;)
+    {
+        if('&' != (*text)[index])
+        {
+            decoded.push_back((*text)[index++]);
+            continue;
+        }
+        bool replaced = false;
+        for(const auto &entity : entities)
+        {
+            const size_t length = strlen(entity.name);
+            if(0 == text->compare(index, length, entity.name))
+            {
+                decoded.push_back(entity.character);
+                index += length;
+                replaced = true;
+                break;
+            }
+        }
+        const size_t semicolon = text->find(';', index);
+        if(false == replaced && 0 == text->compare(index, 2, "&#") && string::npos != semicolon)
+        {
+            const bool hexadecimal = index+2 < text->size() && 'x' == (*text)[index+2];
+            const string digits(*text, index+(hexadecimal ? 3 : 2),
+                                semicolon-index-(hexadecimal ? 3 : 2));
+            char *end = nullptr;
+            const unsigned long code = strtoul(digits.c_str(), &end, hexadecimal ? 16 : 10);
+            if(false == digits.empty() && '\0' == *end && code < 256)
+            {
+                decoded.push_back(static_cast<char>(code));
+                index = semicolon+1;
+                replaced = true;
+            }
+        }
+        if(false == replaced)
+        {
+            decoded.push_back((*text)[index++]);
+        }
+    }
+    text->swap(decoded);
+}
+
+// ParseGcpPoint without the console, *error tells what is wrong
+bool ReadGcpPoint(const char *text, size_t size, GcpData *gcp, const char **error)
+{
+    static const char* const missingMessages[] = {"Invalid GCP file: cannot find x coordinate",
+                                                  "Invalid GCP file: cannot find y coordinate",
+                                                  "Invalid GCP file: cannot find z coordinate"};
+    double* const coordinates[] = {&gcp->x, &gcp->y, &gcp->z};
+    const char *cursor = text;
+    const char* const end = text+size;
+    for(size_t index = 0; 3 != index; ++index)
+    {
+        // any white space before each number, at least some between them
+        const char *numberBegin = cursor;
+        while(end != numberBegin && IsSpace(*numberBegin))
+        {
+            ++numberBegin;
+        }
+        if(end == numberBegin)
+        {
+            *error = missingMessages[index];
+            return false;
+        }
+        if(0 != index && numberBegin == cursor)
+        {
+            *error = "Invalid GCP file: coordinates must be separated by white space";
+            return false;
+        }
+        cursor = ParseDouble(numberBegin, end, coordinates[index]);
+        if(numberBegin == cursor)
+        {
+            *error = missingMessages[index];
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+bool ParseGcpPoint(const char *text, size_t size, GcpData *gcp)
+{
+    const char *error = nullptr;
+    if(false == ReadGcpPoint(text, size, gcp, &error))
+    {
+        cout<<endl<<error<<endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<ByteSource> OpenReadAheadFile(const string &filePath)
+{
+    FILE *file = fopen(filePath.c_str(), "rb");
+    if(nullptr == file)
+    {
+        return std::unique_ptr<ByteSource>();
+    }
+    return std::unique_ptr<ByteSource>(new ReadAheadFile(file));
+}
+
+std::unique_ptr<ByteSource> OpenMemory(const char *data, size_t size)
+{
+    return std::unique_ptr<ByteSource>(new MemorySource(data, size));
+}
+
+GcpFileFormat GcpFileFormatOf(const string &filePath)
+{
+    // the first bytes tell, whatever the name of the file
+    char head[512];
+    size_t headSize = 0;
+    FILE *file = fopen(filePath.c_str(), "rb");
+    if(nullptr != file)
+    {
+        headSize = fread(head, 1, sizeof(head), file);
+        fclose(file);
+    }
+    if((headSize >= 4 && 0 == memcmp(head, "ply\n", 4)) ||
+       (headSize >= 5 && 0 == memcmp(head, "ply\r\n", 5)))
+    {
+        return GcpFileFormat::Ply;
+    }
+    size_t offset = headSize >= 3 && 0 == memcmp(head, "\xEF\xBB\xBF", 3) ? 3 : 0;
+    while(headSize != offset && 0 != isspace(static_cast<unsigned char>(head[offset])))
+    {
+        ++offset;
+    }
+    if(headSize != offset)
+    {
+        return '<' == head[offset] ? GcpFileFormat::Xml : GcpFileFormat::Text;
+    }
+    // unreadable or blank, the extension decides
+    const size_t dotIndex = filePath.find_last_of('.');
+    const size_t slashIndex = filePath.find_last_of("/\\");
+    if(string::npos == dotIndex || (string::npos != slashIndex && slashIndex > dotIndex))
+    {
+        return GcpFileFormat::Xml;
+    }
+    string extension(filePath, dotIndex);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if(".txt" == extension || ".csv" == extension)
+    {
+        return GcpFileFormat::Text;
+    }
+    if(".ply" == extension)
+    {
+        return GcpFileFormat::Ply;
+    }
+    return GcpFileFormat::Xml;
+}
+
+std::unique_ptr<GcpReader> MakeGcpReader(GcpFileFormat format, ByteSource *source)
+{
+    switch(format)
+    {
+    case GcpFileFormat::Text:
+        return std::unique_ptr<GcpReader>(new GcpTextReader(source));
+    case GcpFileFormat::Ply:
+        return std::unique_ptr<GcpReader>(new GcpPlyReader(source));
+    default:
+        return std::unique_ptr<GcpReader>(new GcpStreamReader(source));
+    }
+}
+
+SourceBuffer::SourceBuffer(ByteSource *source)
+    : m_source(source), m_cursor(0), m_size(0), m_sourceEnded(false), m_consumed(0)
+{}
+
+const char* SourceBuffer::Data() const
+{
+    return m_buffer.data()+m_cursor;
+}
+
+size_t SourceBuffer::Size() const
+{
+    return m_size-m_cursor;
+}
+
+size_t SourceBuffer::Offset() const
+{
+    return m_consumed+m_cursor;
+}
+
+void SourceBuffer::Consume(size_t count)
+{
+    m_cursor += count;
+}
+
+bool SourceBuffer::Ensure(size_t count)
+{
+    while(m_size-m_cursor < count)
+    {
+        if(m_sourceEnded)
+        {
+            return false;
+        }
+        // keep only what is after the cursor, the buffer stays
+        // about one read long whatever the size of the file
+        if(0 != m_cursor)
+        {
+            memmove(m_buffer.data(), m_buffer.data()+m_cursor, m_size-m_cursor);
+            m_size -= m_cursor;
+            m_consumed += m_cursor;
+            m_cursor = 0;
+        }
+        if(m_buffer.size()-m_size < g_parseReadSize)
+        {
+            m_buffer.resize(m_size+g_parseReadSize);
+        }
+        const size_t byteRead = m_source->Read(m_buffer.data()+m_size, m_buffer.size()-m_size);
+        if(0 == byteRead)
+        {
+            m_sourceEnded = true;
+        }
+        m_size += byteRead;
+    }
+    return true;
+}
+
+bool SourceBuffer::Find(const char *pattern, size_t *offset)
+{
+    const size_t patternSize = strlen(pattern);
+    size_t searched = 0;
+    while(true)
+    {
+        const char *begin = m_buffer.data()+m_cursor;
+        const char *end = m_buffer.data()+m_size;
+        const char *found = std::search(begin+searched, end, pattern, pattern+patternSize);
+        if(end != found)
+        {
+            *offset = static_cast<size_t>(found-begin);
+            return true;
+        }
+        // the pattern may start in the last bytes
+        const size_t available = m_size-m_cursor;
+        searched = available < patternSize ? 0 : available-patternSize+1;
+        if(false == Ensure(available+1))
+        {
+            return false;
+        }
+    }
+}
+
+bool SourceBuffer::ReadLine(const char **line, size_t *size)
+{
+    if(false == Ensure(1))
+    {
+        return false;
+    }
+    size_t length = 0;
+    if(false == Find("\n", &length))
+    {
+        // the last line has no end of line
+        length = Size();
+        *line = Data();
+        *size = length;
+        Consume(length);
+        return true;
+    }
+    *line = Data();
+    *size = 0 != length && '\r' == (*line)[length-1] ? length-1 : length;
+    Consume(length+1);
+    return true;
+}
+
+GcpStreamReader::GcpStreamReader(ByteSource *source, GcpStreamPart part)
+    : m_input(source), m_part(part), m_inRoot(false), m_inGcps(false), m_good(true)
+{
+    if(GcpStreamPart::Middle == part || GcpStreamPart::Tail == part)
+    {
+        m_inRoot = m_inGcps = true;
+    }
+}
+
+bool GcpStreamReader::Good() const
+{
+    return m_good;
+}
+
+bool GcpStreamReader::Fail(const char *message)
+{
+    if(GcpStreamPart::Whole == m_part)
+    {
+        cout<<endl<<"Invalid GCP file: "<<message<<" near byte "<<m_input.Offset()<<endl;
+    }
+    m_good = false;
+    return false;
+}
+
+bool GcpStreamReader::Report(const char *message)
+{
+    if(GcpStreamPart::Whole == m_part)
+    {
+        cout<<endl<<message<<endl;
+    }
+    m_good = false;
+    return false;
+}
+
+bool GcpStreamReader::ReadToken(Token *token)
+{
+    while(true)
+    {
+        if(false == m_input.Ensure(1))
+        {
+            token->type = TokenType::End;
+            return true;
+        }
+        if('<' != m_input.Data()[0])
+        {
+            size_t offset = 0;
+            if(false == m_input.Find("<", &offset))
+            {
+                offset = m_input.Size();
+            }
+            token->type = TokenType::Text;
+            token->value.assign(m_input.Data(), offset);
+            m_input.Consume(offset);
+            return true;
+        }
+        if(false == m_input.Ensure(2))
+        {
+            return Fail("unexpected end of data");
+        }
+        const char second = m_input.Data()[1];
+        size_t offset = 0;
+        if('?' == second)
+        {
+            // <?xml version="1.0" ?>
+            if(false == m_input.Find("?>", &offset))
+            {
+                return Fail("unterminated processing instruction");
+            }
+            m_input.Consume(offset+2);
+            continue;
+        }
+        if('!' == second)
+        {
+            if(m_input.Ensure(4) && 0 == memcmp(m_input.Data(), "<!--", 4))
+            {
+                if(false == m_input.Find("-->", &offset))
+                {
+                    return Fail("unterminated comment");
+                }
+                m_input.Consume(offset+3);
+                continue;
+            }
+            if(m_input.Ensure(9) && 0 == memcmp(m_input.Data(), "<![CDATA[", 9))
+            {
+                return Fail("CDATA is not supported");
+            }
+            // <!DOCTYPE ...>
+            if(false == m_input.Find(">", &offset))
+            {
+                return Fail("unterminated declaration");
+            }
+            m_input.Consume(offset+1);
+            continue;
+        }
+        if('/' == second)
+        {
+            if(false == m_input.Find(">", &offset))
+            {
+                return Fail("unterminated end tag");
+            }
+            const char *name = m_input.Data()+2;
+            const char *nameEnd = m_input.Data()+offset;
+            while(nameEnd != name && IsSpace(nameEnd[-1]))
+            {
+                --nameEnd;
+            }
+            token->type = TokenType::EndTag;
+            token->value.assign(name, nameEnd);
+            m_input.Consume(offset+1);
+            return true;
+        }
+        // start tag, the attributes are skipped, a '>' may be quoted in them
+        char quote = '\0';
+        size_t length = 1;
+        for(;; ++length)
+        {
+            if(false == m_input.Ensure(length+1))
+            {
+                return Fail("unterminated start tag");
+            }
+            const char character = m_input.Data()[length];
+            if('\0' != quote)
+            {
+                quote = quote == character ? '\0' : quote;
+            }
+            else if('"' == character || '\'' == character)
+            {
+                quote = character;
+            }
+            else if('>' == character)
+            {
+                break;
+            }
+        }
+        const char *name = m_input.Data()+1;
+        const char *nameEnd = name;
+        while(false == IsSpace(*nameEnd) && '/' != *nameEnd && '>' != *nameEnd)
+        {
+            ++nameEnd;
+        }
+        if(nameEnd == name)
+        {
+            return Fail("expected element name");
+        }
+        token->type = '/' == m_input.Data()[length-1] ? TokenType::EmptyTag : TokenType::StartTag;
+        token->value.assign(name, nameEnd);
+        m_input.Consume(length+1);
+        return true;
+    }
+}
+
+bool GcpStreamReader::SkipElement()
+{
+    Token token;
+    for(size_t depth = 1; 0 != depth;)
+    {
+        if(false == ReadToken(&token))
+        {
+            return false;
+        }
+        switch(token.type)
+        {
+        case TokenType::StartTag:
+            ++depth;
+            break;
+        case TokenType::EndTag:
+            --depth;
+            break;
+        case TokenType::End:
+            return Fail("unexpected end of data");
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+bool GcpStreamReader::ReadElementText(string *text)
+{
+    text->clear();
+    bool textFound = false;
+    Token token;
+    for(size_t depth = 1; 0 != depth;)
+    {
+        if(false == ReadToken(&token))
+        {
+            return false;
+        }
+        switch(token.type)
+        {
+        case TokenType::StartTag:
+            ++depth;
+            break;
+        case TokenType::EndTag:
+            --depth;
+            break;
+        case TokenType::Text:
+            // as rapidxml: the first text that is not only white space
+            if(1 == depth && false == textFound &&
+               token.value.end() != std::find_if(token.value.begin(), token.value.end(),
+                                                 [](char character){return false == IsSpace(character);}))
+            {
+                textFound = true;
+                text->swap(token.value);
+                DecodeEntities(text);
+            }
+            break;
+        case TokenType::End:
+            return Fail("unexpected end of data");
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+bool GcpStreamReader::Next(GcpData *gcp)
+{
+    if(false == m_good)
+    {
+        return false;
+    }
+    Token token;
+    // up to the start tag of the next GCP
+    while(true)
+    {
+        if(false == ReadToken(&token))
+        {
+            return false;
+        }
+        if(false == m_inRoot)
+        {
+            if(TokenType::End == token.type)
+            {
+                return Report("Invalid GCP file, target node name: dicoAppuisFlottant");
+            }
+            if(TokenType::Text == token.type)
+            {
+                if(token.value.end() != std::find_if(token.value.begin(), token.value.end(),
+                                                     [](char character){return false == IsSpace(character);}))
+                {
+                    return Fail("expected <");
+                }
+                continue;
+            }
+            const bool isRoot = "DicoAppuisFlottant" == token.value;
+            if(TokenType::StartTag == token.type && isRoot)
+            {
+                m_inRoot = true;
+            }
+            else if(TokenType::EmptyTag == token.type && isRoot)
+            {
+                // no GCP at all
+                return false;
+            }
+            else if(TokenType::StartTag == token.type && false == SkipElement())
+            {
+                return false;
+            }
+            continue;
+        }
+        const bool partEndsInRoot = GcpStreamPart::Head == m_part || GcpStreamPart::Middle == m_part;
+        if(TokenType::End == token.type)
+        {
+            // a Head or Middle ends between two GCPs
+            return partEndsInRoot && m_inGcps ? false : Fail("unexpected end of data");
+        }
+        if(TokenType::EndTag == token.type)
+        {
+            // end of DicoAppuisFlottant, what follows is not read
+            return partEndsInRoot ? Fail("unexpected end of DicoAppuisFlottant") : false;
+        }
+        if(TokenType::Text == token.type)
+        {
+            continue;
+        }
+        // every element from the first OneAppuisDAF on is a GCP
+        if(false == m_inGcps && "OneAppuisDAF" != token.value)
+        {
+            if(TokenType::StartTag == token.type && false == SkipElement())
+            {
+                return false;
+            }
+            continue;
+        }
+        m_inGcps = true;
+        break;
+    }
+
+    bool ptFound = false;
+    bool nameFound = false;
+    string ptText;
+    gcp->name.clear();
+    if(TokenType::StartTag == token.type)
+    {
+        Token child;
+        while(true)
+        {
+            if(false == ReadToken(&child))
+            {
+                return false;
+            }
+            if(TokenType::End == child.type)
+            {
+                return Fail("unexpected end of data");
+            }
+            if(TokenType::EndTag == child.type)
+            {
+                break;
+            }
+            if(TokenType::Text == child.type)
+            {
+                continue;
+            }
+            const bool isPt = false == ptFound && "Pt" == child.value;
+            const bool isName = false == nameFound && "NamePt" == child.value;
+            if(TokenType::EmptyTag == child.type)
+            {
+                ptFound = ptFound || isPt;
+                nameFound = nameFound || isName;
+            }
+            else if(isPt)
+            {
+                ptFound = true;
+                if(false == ReadElementText(&ptText))
+                {
+                    return false;
+                }
+            }
+            else if(isName)
+            {
+                nameFound = true;
+                if(false == ReadElementText(&gcp->name))
+                {
+                    return false;
+                }
+            }
+            else if(false == SkipElement())
+            {
+                return false;
+            }
+        }
+    }
+    if(false == ptFound)
+    {
+        return Report("Invalid GCP file, cannot find coordinate field");
+    }
+    if(false == nameFound)
+    {
+        return Report("Invalid GCP file, cannot find GCP name field");
+    }
+    const char *error = nullptr;
+    if(false == ReadGcpPoint(ptText.data(), ptText.size(), gcp, &error))
+    {
+        return Report(error);
+    }
+    return true;
+}
+
+bool ReadGcpsInParallel(const char *data, size_t size, unsigned threadCount,
+                        vector<GcpData> *gcps)
+{
+    gcps->clear();
+    // a few parts per thread so that they end together
+    const size_t partCount = std::min<size_t>(threadCount*4, size/g_minPartSize);
+    if(threadCount < 2 || partCount < 2)
+    {
+        return false;
+    }
+    // cut before the first "<OneAppuisDAF" following a "</OneAppuisDAF>" after
+    // each even share, the parse of the part ahead tells whether it really
+    // was the start tag of a GCP, not one in a comment or a nested element
+    static const char startTag[] = "<OneAppuisDAF";
+    static const char endTag[] = "</OneAppuisDAF>";
+    const size_t startTagSize = sizeof(startTag)-1;
+    const size_t endTagSize = sizeof(endTag)-1;
+    const char *end = data+size;
+    vector<const char*> cuts(1, data);
+    for(size_t partIndex = 1; partCount != partIndex; ++partIndex)
+    {
+        const char *cut = std::max(data+size/partCount*partIndex, cuts.back()+1);
+        while(end != (cut = std::search(cut, end, startTag, startTag+startTagSize)))
+        {
+            const char next = cut+startTagSize == end ? '\0' : cut[startTagSize];
+            const char *previous = cut;
+            while(data != previous && IsSpace(previous[-1]))
+            {
+                --previous;
+            }
+            if(('>' == next || '/' == next || IsSpace(next)) &&
+               static_cast<size_t>(previous-data) >= endTagSize &&
+               0 == memcmp(previous-endTagSize, endTag, endTagSize))
+            {
+                break;
+            }
+            ++cut;
+        }
+        if(end == cut)
+        {
+            break;
+        }
+        cuts.push_back(cut);
+    }
+    if(cuts.size() < 2)
+    {
+        return false;
+    }
+    cuts.push_back(end);
+
+    vector<vector<GcpData>> partGcps(cuts.size()-1);
+    vector<char> partGood(partGcps.size(), 0);
+    ParallelFor(partGcps.size(), threadCount, [&](size_t partIndex, unsigned)
+    {
+        const GcpStreamPart part = 0 == partIndex ? GcpStreamPart::Head :
+                                   partGcps.size() == partIndex+1 ? GcpStreamPart::Tail :
+                                   GcpStreamPart::Middle;
+        MemorySource source(cuts[partIndex], static_cast<size_t>(cuts[partIndex+1]-cuts[partIndex]));
+        GcpStreamReader reader(&source, part);
+        GcpData gcp;
+        while(reader.Next(&gcp))
+        {
+            partGcps[partIndex].push_back(gcp);
+        }
+        partGood[partIndex] = reader.Good() ? 1 : 0;
+    });
+    if(partGood.end() != std::find(partGood.begin(), partGood.end(), 0))
+    {
+        return false;
+    }
+    size_t gcpCount = 0;
+    for(const auto &part : partGcps)
+    {
+        gcpCount += part.size();
+    }
+    gcps->reserve(gcpCount);
+    for(auto &part : partGcps)
+    {
+        std::move(part.begin(), part.end(), std::back_inserter(*gcps));
+        vector<GcpData>().swap(part);
+    }
+    return true;
+}
@@ -0,0 +1,175 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: GcpStreamReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_GCPREADER_H_
+#define COMMON_GCPREADER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+
+// GCP data structure
+struct GcpData
+{
+    std::string name;
+    double x, y, z;
+};
+
+// fill the coordinates of gcp from the text of a Pt node, "x y z" separated
+// by any white space, read in place as in the "C" locale, what follows z is
+// ignored, errors are printed on the console
+bool ParseGcpPoint(const char *text, size_t size, GcpData *gcp);
+
+// where GcpStreamReader takes its bytes from
+class ByteSource
+{
+public:
+    virtual ~ByteSource() {}
+    // up to size bytes into buffer, 0 at the end
+    virtual size_t Read(char *buffer, size_t size) = 0;
+};
+
+// a file read ahead by a thread in blocks, so the parsing of one block
+// overlaps the read of the next ones, at most a few blocks are held
+std::unique_ptr<ByteSource> OpenReadAheadFile(const std::string &filePath);
+// [data, data+size), which must outlive the source
+std::unique_ptr<ByteSource> OpenMemory(const char *data, size_t size);
+
+// the unread bytes of a ByteSource, read as needed, for the GCP readers
+// the buffer stays about one read long whatever the size of the source
+class SourceBuffer
+{
+public:
+    explicit SourceBuffer(ByteSource *source);
+
+    // Size() bytes not consumed yet, valid up to the next Ensure
+    const char* Data() const;
+    size_t Size() const;
+    // bytes consumed since the start of the source
+    size_t Offset() const;
+    void Consume(size_t count);
+    // keep at least count bytes after Data() when the source has them
+    bool Ensure(size_t count);
+    // offset after Data() of the first occurrence of pattern, reading as needed
+    bool Find(const char *pattern, size_t *offset);
+    // the next line without its end of line ("\n" or "\r\n"), consumed,
+    // valid up to the next Ensure, false at the end of the source
+    bool ReadLine(const char **line, size_t *size);
+
+private:
+    ByteSource *m_source;
+    std::vector<char> m_buffer;
+    size_t m_cursor;
+    size_t m_size;
+    bool m_sourceEnded;
+    // bytes consumed before the buffer start
+    size_t m_consumed;
+};
+
+// what the readers of the GCP file formats have in common
+class GcpReader
+{
+public:
+    virtual ~GcpReader() {}
+    // the next GCP, false at the end of the GCPs or on an error (printed)
+    virtual bool Next(GcpData *gcp) = 0;
+    // false once Next met an error
+    virtual bool Good() const = 0;
+};
+
+// the formats of GCP file
+enum class GcpFileFormat
+{
+    // DicoAppuisFlottant
+    Xml,
+    // "name x y z" lines
+    Text,
+    // binary little endian PLY vertices
+    Ply
+};
+
+// told by the content: "ply" on the first line is PLY, a '<' first (after
+// white space or a UTF-8 BOM) is XML, anything else is text
+// an unreadable or blank file goes by its extension: .txt and .csv are
+// text, .ply is PLY, the others XML
+GcpFileFormat GcpFileFormatOf(const std::string &filePath);
+// the reader of format over source, which must outlive it
+std::unique_ptr<GcpReader> MakeGcpReader(GcpFileFormat format, ByteSource *source);
+
+// where the bytes given to a GcpStreamReader start and end
+enum class GcpStreamPart
+{
+    // the whole file
+    Whole,
+    // from the start of the file to a point between two GCPs
+    Head,
+    // from a point between two GCPs to another one
+    Middle,
+    // from a point between two GCPs to the end of the file
+    Tail
+};
+
+// pull parser of a DicoAppuisFlottant, one OneAppuisDAF at a time, for the
+// files too large for a DOM, only the subset of XML that MicMac writes is
+// known: elements, attributes, comments, processing instructions, DOCTYPE and
+// the predefined entities, no CDATA, the memory it needs does not depend on
+// the size of the file, only on the longest element
+// it reads the GCPs as FetchAllGcps does: the children of DicoAppuisFlottant
+// from the first OneAppuisDAF on, with their first Pt and NamePt
+class GcpStreamReader : public GcpReader
+{
+public:
+    // a part other than Whole is read without printing its errors: they
+    // mostly tell that the file was not cut between two GCPs
+    explicit GcpStreamReader(ByteSource *source, GcpStreamPart part = GcpStreamPart::Whole);
+
+    bool Next(GcpData *gcp) override;
+    bool Good() const override;
+
+private:
+    enum class TokenType
+    {
+        StartTag,
+        EmptyTag,
+        EndTag,
+        Text,
+        End
+    };
+    struct Token
+    {
+        TokenType type;
+        // tag name or text, entities not yet decoded
+        std::string value;
+    };
+
+    bool ReadToken(Token *token);
+    // skip the content and end tag of an element whose start tag was read
+    bool SkipElement();
+    // text of an element whose start tag was read, up to its end tag
+    bool ReadElementText(std::string *text);
+    bool Fail(const char *message);
+    // print message unless quiet, Next fails from then on
+    bool Report(const char *message);
+
+    SourceBuffer m_input;
+    GcpStreamPart m_part;
+    bool m_inRoot;
+    bool m_inGcps;
+    bool m_good;
+};
+
+// the GCPs of the file content [data, data+size) in the order of the file,
+// cut at OneAppuisDAF start tags into parts parsed on threadCount threads
+// false when a cut did not fall between two GCPs, when the file is too
+// small to be cut or on any error, nothing is printed: read it as a whole
+bool ReadGcpsInParallel(const char *data, size_t size, unsigned threadCount,
+                        std::vector<GcpData> *gcps);
+
+#endif // COMMON_GCPREADER_H_
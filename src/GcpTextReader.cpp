@@ -0,0 +1,108 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: GcpTextReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "GcpTextReader.h"
+
+#include <iostream>
+
+#include "NumberParser.h"
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+bool IsSeparator(char character)
+{
+    return ' ' == character || '\t' == character || ',' == character || ';' == character;
+}
+
+const char* SkipSeparators(const char *begin, const char *end)
+{
+    while(end != begin && IsSeparator(*begin))
+    {
+        ++begin;
+    }
+    return begin;
+}
+}
+
+GcpTextReader::GcpTextReader(ByteSource *source)
+    : m_input(source), m_lineNumber(0), m_headerChecked(false), m_good(true)
+{}
+
+bool GcpTextReader::Good() const
+{
+    return m_good;
+}
+
+bool GcpTextReader::Fail(const char *message)
+{
+    cout<<endl<<"Invalid GCP file, line "<<m_lineNumber<<": "<<message<<endl;
+    m_good = false;
+    return false;
+}
+
+bool GcpTextReader::Next(GcpData *gcp)
+{
+    if(false == m_good)
+    {
+        return false;
+    }
+    const char *line = nullptr;
+    size_t lineSize = 0;
+    while(m_input.ReadLine(&line, &lineSize))
+    {
+        ++m_lineNumber;
+        const char* const end = line+lineSize;
+        const char *nameBegin = SkipSeparators(line, end);
+        if(end == nameBegin || '#' == *nameBegin)
+        {
+            continue;
+        }
+        const char *cursor = nameBegin;
+        while(end != cursor && false == IsSeparator(*cursor))
+        {
+            ++cursor;
+        }
+        const char* const nameEnd = cursor;
+
+        static const char* const missingMessages[] = {"cannot find x coordinate",
+                                                      "cannot find y coordinate",
+                                                      "cannot find z coordinate"};
+        double* const coordinates[] = {&gcp->x, &gcp->y, &gcp->z};
+        bool header = false;
+        for(size_t index = 0; 3 != index; ++index)
+        {
+            const char *numberBegin = SkipSeparators(cursor, end);
+            if(end == numberBegin)
+            {
+                return Fail(missingMessages[index]);
+            }
+            cursor = ParseDouble(numberBegin, end, coordinates[index]);
+            if(numberBegin == cursor || (end != cursor && false == IsSeparator(*cursor)))
+            {
+                if(0 == index && false == m_headerChecked)
+                {
+                    header = true;
+                    break;
+                }
+                return Fail("coordinates must be numbers");
+            }
+        }
+        m_headerChecked = true;
+        if(header)
+        {
+            continue;
+        }
+        gcp->name.assign(nameBegin, nameEnd);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,40 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: GcpTextReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_GCPTEXTREADER_H_
+#define COMMON_GCPTEXTREADER_H_
+
+#include <cstddef>
+
+#include "GcpReader.h"
+
+// GCPs as delimited text, one "name x y z" per line, the fields separated
+// by any run of spaces, tabs, commas or semicolons, so the numbers are read
+// with a '.' whatever the locale, the columns after z are ignored
+// empty lines and lines starting with '#' are skipped, and so is the first
+// line when its second field is not a number (a header)
+class GcpTextReader : public GcpReader
+{
+public:
+    explicit GcpTextReader(ByteSource *source);
+
+    bool Next(GcpData *gcp) override;
+    bool Good() const override;
+
+private:
+    bool Fail(const char *message);
+
+    SourceBuffer m_input;
+    size_t m_lineNumber;
+    // the first GCP line is behind
+    bool m_headerChecked;
+    bool m_good;
+};
+
+#endif // COMMON_GCPTEXTREADER_H_
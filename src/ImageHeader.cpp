@@ -0,0 +1,390 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ReadImageSizeFromHeader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ImageHeader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <boost/predef/os.h>
+
+#if BOOST_OS_WINDOWS == 0
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+namespace
+{
+// the first bytes of the file are read once, the headers of most images
+// fit in them, a marker further away costs one more positioned read
+constexpr size_t g_headBufferSize = 4096;
+
+class HeaderFile
+{
+public:
+    explicit HeaderFile(const string &filePath)
+        : m_headSize(0)
+    {
+#if BOOST_OS_WINDOWS == 0
+        m_fd = open(filePath.c_str(), O_RDONLY|O_CLOEXEC);
+        if(-1 == m_fd)
+        {
+            return;
+        }
+#else
+        m_file = fopen(filePath.c_str(), "rb");
+        if(nullptr == m_file)
+        {
+            return;
+        }
+#endif
+        m_headSize = ReadFromFile(0, m_head, g_headBufferSize);
+    }
+    ~HeaderFile()
+    {
+#if BOOST_OS_WINDOWS == 0
+        if(-1 != m_fd)
+        {
+            close(m_fd);
+        }
+#else
+        if(nullptr != m_file)
+        {
+            fclose(m_file);
+        }
+#endif
+    }
+    HeaderFile(const HeaderFile&) = delete;
+    HeaderFile& operator=(const HeaderFile&) = delete;
+
+    // read exactly size bytes at offset
+    bool Read(uint64_t offset, unsigned char *buffer, size_t size)
+    {
+        if(offset+size <= m_headSize)
+        {
+            memcpy(buffer, m_head+offset, size);
+            return true;
+        }
+        return size == ReadFromFile(offset, buffer, size);
+    }
+    size_t HeadSize() const
+    {
+        return m_headSize;
+    }
+    const unsigned char* Head() const
+    {
+        return m_head;
+    }
+
+private:
+    size_t ReadFromFile(uint64_t offset, unsigned char *buffer, size_t size)
+    {
+#if BOOST_OS_WINDOWS == 0
+        if(-1 == m_fd)
+        {
+            return 0;
+        }
+        size_t total = 0;
+        while(total < size)
+        {
+            const ssize_t byteRead = pread(m_fd, buffer+total, size-total,
+                                           static_cast<off_t>(offset+total));
+            if(byteRead <= 0)
+            {
+                break;
+            }
+            total += static_cast<size_t>(byteRead);
+        }
+        return total;
+#else
+        if(nullptr == m_file || 0 != _fseeki64(m_file, static_cast<__int64>(offset), SEEK_SET))
+        {
+            return 0;
+        }
+        return fread(buffer, 1, size, m_file);
+#endif
+    }
+
+#if BOOST_OS_WINDOWS == 0
+    int m_fd;
+#else
+    FILE *m_file;
+#endif
+    unsigned char m_head[g_headBufferSize];
+    size_t m_headSize;
+};
+
+uint16_t BigEndian16(const unsigned char *bytes)
+{
+    return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+uint32_t BigEndian32(const unsigned char *bytes)
+{
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+uint16_t Read16(const unsigned char *bytes, bool bigEndian)
+{
+    return bigEndian ? BigEndian16(bytes) : static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t Read32(const unsigned char *bytes, bool bigEndian)
+{
+    return bigEndian ? BigEndian32(bytes) :
+                       (static_cast<uint32_t>(bytes[3]) << 24) | (static_cast<uint32_t>(bytes[2]) << 16) |
+                       (static_cast<uint32_t>(bytes[1]) << 8) | bytes[0];
+}
+
+bool IsStartOfFrame(unsigned char marker)
+{
+    // SOF0..SOF15 except DHT(C4), JPG(C8) and DAC(CC)
+    return marker >= 0xC0 && marker <= 0xCF &&
+           0xC4 != marker && 0xC8 != marker && 0xCC != marker;
+}
+
+bool ReadJpegSize(HeaderFile *file, size_t *width, size_t *height)
+{
+    uint64_t offset = 2;
+    unsigned char segment[9];
+    while(true)
+    {
+        if(false == file->Read(offset, segment, 2) || 0xFF != segment[0])
+        {
+            return false;
+        }
+        const unsigned char marker = segment[1];
+        if(0xFF == marker)
+        {
+            // fill byte
+            ++offset;
+            continue;
+        }
+        if(0x01 == marker || (marker >= 0xD0 && marker <= 0xD7))
+        {
+            // no length field
+            offset += 2;
+            continue;
+        }
+        if(0xD9 == marker || 0xDA == marker)
+        {
+            // end of image or start of scan before any frame header
+            return false;
+        }
+        if(IsStartOfFrame(marker))
+        {
+            // length(2) precision(1) height(2) width(2)
+            if(false == file->Read(offset+2, segment+2, 7))
+            {
+                return false;
+            }
+            *height = BigEndian16(segment+5);
+            *width = BigEndian16(segment+7);
+            // a height of 0 is given later by a DNL marker, leave it to exiv2
+            return 0 != *width && 0 != *height;
+        }
+        if(false == file->Read(offset+2, segment+2, 2))
+        {
+            return false;
+        }
+        const uint16_t length = BigEndian16(segment+2);
+        if(length < 2)
+        {
+            return false;
+        }
+        offset += 2+length;
+    }
+}
+
+// the few entries of one TIFF IFD that tell which image it holds
+constexpr size_t g_maxSubIfdCount = 8;
+struct TiffIfd
+{
+    size_t width, height;
+    // NewSubfileType (254), bit 0 is set for a reduced resolution image
+    uint32_t subfileType;
+    // SubIFDs (330), where raw files keep the full resolution image
+    uint32_t subIfds[g_maxSubIfdCount];
+    size_t subIfdCount;
+    uint32_t nextIfd;
+};
+
+// a single SHORT(3), LONG(4) or IFD(13) value stored in the entry
+bool ReadTiffEntryValue(const unsigned char *entry, bool bigEndian, uint32_t *value)
+{
+    const uint16_t type = Read16(entry+2, bigEndian);
+    if(3 == type)
+    {
+        *value = Read16(entry+8, bigEndian);
+        return true;
+    }
+    if(4 == type || 13 == type)
+    {
+        *value = Read32(entry+8, bigEndian);
+        return true;
+    }
+    return false;
+}
+
+bool ReadTiffIfd(HeaderFile *file, bool bigEndian, uint32_t ifdOffset, TiffIfd *ifd)
+{
+    unsigned char entryCountBytes[2];
+    if(false == file->Read(ifdOffset, entryCountBytes, 2))
+    {
+        return false;
+    }
+    const uint16_t entryCount = Read16(entryCountBytes, bigEndian);
+    ifd->width = ifd->height = 0;
+    ifd->subfileType = 0;
+    ifd->subIfdCount = 0;
+    unsigned char entry[12];
+    for(uint16_t index = 0; entryCount != index; ++index)
+    {
+        if(false == file->Read(ifdOffset+2+12ull*index, entry, sizeof(entry)))
+        {
+            return false;
+        }
+        const uint16_t tag = Read16(entry, bigEndian);
+        uint32_t value = 0;
+        if(254 == tag || 256 == tag || 257 == tag)
+        {
+            if(false == ReadTiffEntryValue(entry, bigEndian, &value))
+            {
+                return false;
+            }
+            if(254 == tag)
+            {
+                ifd->subfileType = value;
+            }
+            else
+            {
+                (256 == tag ? ifd->width : ifd->height) = value;
+            }
+        }
+        else if(330 == tag)
+        {
+            // one offset is stored in the entry, more are stored where it points
+            const uint16_t type = Read16(entry+2, bigEndian);
+            const uint32_t count = Read32(entry+4, bigEndian);
+            if((4 != type && 13 != type) || 0 == count)
+            {
+                continue;
+            }
+            ifd->subIfdCount = count < g_maxSubIfdCount ? count : g_maxSubIfdCount;
+            if(1 == count)
+            {
+                ifd->subIfds[0] = Read32(entry+8, bigEndian);
+                continue;
+            }
+            unsigned char offsets[4*g_maxSubIfdCount];
+            if(false == file->Read(Read32(entry+8, bigEndian), offsets, 4*ifd->subIfdCount))
+            {
+                return false;
+            }
+            for(size_t subIfd = 0; ifd->subIfdCount != subIfd; ++subIfd)
+            {
+                ifd->subIfds[subIfd] = Read32(offsets+4*subIfd, bigEndian);
+            }
+        }
+    }
+    unsigned char nextIfdBytes[4];
+    if(false == file->Read(ifdOffset+2+12ull*entryCount, nextIfdBytes, sizeof(nextIfdBytes)))
+    {
+        return false;
+    }
+    ifd->nextIfd = Read32(nextIfdBytes, bigEndian);
+    return true;
+}
+
+// In NEF, DNG and most TIFF based raw files IFD0 holds a reduced resolution
+// preview, the full image is in one of its SubIFDs or further down the IFD
+// chain. The first IFD not marked as reduced resolution (NewSubfileType bit 0)
+// gives the size, IFD0 first, then its SubIFDs, then the next IFD.
+bool ReadTiffSize(HeaderFile *file, bool bigEndian, size_t *width, size_t *height)
+{
+    // visited IFDs are not tracked, the bound stops a chain that loops
+    constexpr size_t maxIfdCount = 32;
+    uint32_t pending[maxIfdCount+g_maxSubIfdCount+1];
+    size_t pendingCount = 0;
+    pending[pendingCount++] = Read32(file->Head()+4, bigEndian);
+    for(size_t ifdCount = 0; 0 != pendingCount && maxIfdCount != ifdCount; ++ifdCount)
+    {
+        const uint32_t ifdOffset = pending[--pendingCount];
+        TiffIfd ifd;
+        if(0 == ifdOffset || false == ReadTiffIfd(file, bigEndian, ifdOffset, &ifd))
+        {
+            return false;
+        }
+        if(0 == (ifd.subfileType & 1) && 0 != ifd.width && 0 != ifd.height)
+        {
+            *width = ifd.width;
+            *height = ifd.height;
+            return true;
+        }
+        if(pendingCount+1+ifd.subIfdCount > sizeof(pending)/sizeof(pending[0]))
+        {
+            return false;
+        }
+        // a stack: the SubIFDs are visited before the next IFD
+        if(0 != ifd.nextIfd)
+        {
+            pending[pendingCount++] = ifd.nextIfd;
+        }
+        for(size_t subIfd = ifd.subIfdCount; 0 != subIfd; --subIfd)
+        {
+            pending[pendingCount++] = ifd.subIfds[subIfd-1];
+        }
+    }
+    // no full resolution image was found, exiv2 decides
+    return false;
+}
+
+bool ReadPngSize(HeaderFile *file, size_t *width, size_t *height)
+{
+    // signature(8) length(4) "IHDR" width(4) height(4)
+    if(file->HeadSize() < 24 || 0 != memcmp(file->Head()+12, "IHDR", 4))
+    {
+        return false;
+    }
+    *width = BigEndian32(file->Head()+16);
+    *height = BigEndian32(file->Head()+20);
+    return 0 != *width && 0 != *height;
+}
+}
+
+bool ReadImageSizeFromHeader(const string &imageFilePath, size_t *width, size_t *height)
+{
+    HeaderFile file(imageFilePath);
+    const unsigned char *head = file.Head();
+    if(file.HeadSize() < 8)
+    {
+        return false;
+    }
+    if(0xFF == head[0] && 0xD8 == head[1])
+    {
+        return ReadJpegSize(&file, width, height);
+    }
+    if(0 == memcmp(head, "II*\0", 4))
+    {
+        return ReadTiffSize(&file, false, width, height);
+    }
+    if(0 == memcmp(head, "MM\0*", 4))
+    {
+        return ReadTiffSize(&file, true, width, height);
+    }
+    if(0 == memcmp(head, "\x89PNG\r\n\x1a\n", 8))
+    {
+        return ReadPngSize(&file, width, height);
+    }
+    return false;
+}
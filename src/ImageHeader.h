@@ -0,0 +1,23 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ReadImageSizeFromHeader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_IMAGEHEADER_H_
+#define COMMON_IMAGEHEADER_H_
+
+#include <cstddef>
+#include <string>
+
+// width and height from the header of a JPEG (SOFn marker), TIFF (ImageWidth and
+// ImageLength of the first IFD that is not a reduced resolution image, raw files
+// keep their preview in IFD0) or PNG (IHDR chunk) file, without decoding it
+// only the headers are read, returns false for any other format
+bool ReadImageSizeFromHeader(const std::string &imageFilePath,
+                             size_t *width, size_t *height);
+
+#endif // COMMON_IMAGEHEADER_H_
@@ -0,0 +1,627 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: ImagePattern
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ImagePattern.h"
+
+#include <cctype>
+#include <cstring>
+#include <bitset>
+#include <map>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+using std::map;
+
+namespace
+{
+typedef std::bitset<128> CharSet;
+
+// beyond these the expression is left to boost::regex
+constexpr size_t g_maxNfaStates = 16384;
+constexpr size_t g_maxDfaStates = 4096;
+
+// the escaped punctuation that is not a literal in the perl syntax of boost:
+// \< \> word boundaries, \` \' buffer anchors
+bool IsEscapedLiteral(char character)
+{
+    return character > ' ' && character < 127 && 0 == isalnum(static_cast<unsigned char>(character)) &&
+           nullptr == strchr("<>`'", character);
+}
+
+bool IsMeta(char character)
+{
+    return nullptr != strchr("\\.[](){}*+?|^$", character);
+}
+
+bool IsLiteral(char character)
+{
+    return character >= ' ' && character < 127 && false == IsMeta(character);
+}
+
+// \d \w \s in the ASCII range
+bool ClassEscape(char character, CharSet *characters)
+{
+    CharSet set;
+    for(int code = 0; code < 128; ++code)
+    {
+        const bool isDigit = code >= '0' && code <= '9';
+        const bool isWord = isDigit || (code >= 'a' && code <= 'z') || (code >= 'A' && code <= 'Z') || '_' == code;
+        const bool isSpace = ' ' == code || (code >= '\t' && code <= '\r');
+        set[code] = ('d' == character && isDigit) || ('w' == character && isWord) ||
+                    ('s' == character && isSpace);
+    }
+    if(nullptr == strchr("dws", character))
+    {
+        return false;
+    }
+    *characters |= set;
+    return true;
+}
+
+struct NfaState
+{
+    CharSet characters;
+    // where characters lead, -1 for none
+    int next;
+    vector<int> epsilons;
+};
+
+struct Fragment
+{
+    int start;
+    int end;
+};
+
+// Thompson NFA of the expressions made of literals, classes, '.', \d \w \s
+// and their complements, groups, '|' and the * + ? quantifiers (lazy or not),
+// anchored at both ends
+class ExpressionParser
+{
+public:
+    explicit ExpressionParser(const string &expression)
+        : m_text(expression), m_position(0)
+    {}
+
+    bool Parse(vector<NfaState> *states, int *start, int *accept)
+    {
+        m_states.clear();
+        // '^' and a final '$' change nothing to a whole string match
+        // of a name without a new line
+        if(false == m_text.empty() && '^' == m_text[0])
+        {
+            m_position = 1;
+        }
+        if(m_text.size() > m_position && '$' == m_text.back() &&
+           (m_text.size() < 2 || '\\' != m_text[m_text.size()-2]))
+        {
+            m_text.pop_back();
+        }
+        Fragment whole;
+        if(false == ParseAlternation(&whole) || m_text.size() != m_position)
+        {
+            return false;
+        }
+        states->swap(m_states);
+        *start = whole.start;
+        *accept = whole.end;
+        return true;
+    }
+
+private:
+    int NewState()
+    {
+        m_states.emplace_back();
+        m_states.back().next = -1;
+        return static_cast<int>(m_states.size()-1);
+    }
+
+    bool AtEnd() const
+    {
+        return m_text.size() == m_position;
+    }
+
+    bool ParseAlternation(Fragment *fragment)
+    {
+        if(false == ParseSequence(fragment))
+        {
+            return false;
+        }
+        while(false == AtEnd() && '|' == m_text[m_position])
+        {
+            ++m_position;
+            Fragment other;
+            if(false == ParseSequence(&other))
+            {
+                return false;
+            }
+            const int start = NewState();
+            const int end = NewState();
+            m_states[start].epsilons = {fragment->start, other.start};
+            m_states[fragment->end].epsilons.push_back(end);
+            m_states[other.end].epsilons.push_back(end);
+            *fragment = {start, end};
+        }
+        return true;
+    }
+
+    bool ParseSequence(Fragment *fragment)
+    {
+        fragment->start = fragment->end = NewState();
+        while(false == AtEnd() && '|' != m_text[m_position] && ')' != m_text[m_position])
+        {
+            Fragment atom;
+            if(false == ParseAtom(&atom) || false == ParseQuantifier(&atom))
+            {
+                return false;
+            }
+            m_states[fragment->end].epsilons.push_back(atom.start);
+            fragment->end = atom.end;
+            if(m_states.size() > g_maxNfaStates)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseQuantifier(Fragment *atom)
+    {
+        if(AtEnd() || nullptr == strchr("*+?", m_text[m_position]))
+        {
+            return true;
+        }
+        const char quantifier = m_text[m_position++];
+        // lazy is the same language, possessive is not
+        if(false == AtEnd() && '?' == m_text[m_position])
+        {
+            ++m_position;
+        }
+        if(false == AtEnd() && nullptr != strchr("*+?{", m_text[m_position]))
+        {
+            return false;
+        }
+        const int end = NewState();
+        if('+' == quantifier)
+        {
+            m_states[atom->end].epsilons = {atom->start, end};
+            atom->end = end;
+            return true;
+        }
+        const int start = NewState();
+        m_states[start].epsilons = {atom->start, end};
+        m_states[atom->end].epsilons.push_back(end);
+        if('*' == quantifier)
+        {
+            m_states[atom->end].epsilons.push_back(atom->start);
+        }
+        *atom = {start, end};
+        return true;
+    }
+
+    bool ParseAtom(Fragment *atom)
+    {
+        const char character = m_text[m_position++];
+        CharSet characters;
+        if('(' == character)
+        {
+            if(false == AtEnd() && '?' == m_text[m_position])
+            {
+                // only (?: ), the others change the matching
+                if(m_text.compare(m_position, 2, "?:") != 0)
+                {
+                    return false;
+                }
+                m_position += 2;
+            }
+            if(false == ParseAlternation(atom) || AtEnd() || ')' != m_text[m_position])
+            {
+                return false;
+            }
+            ++m_position;
+            return true;
+        }
+        if('[' == character)
+        {
+            if(false == ParseClass(&characters))
+            {
+                return false;
+            }
+        }
+        else if('.' == character)
+        {
+            characters.set();
+            characters.reset('\n');
+        }
+        else if('\\' == character)
+        {
+            if(AtEnd())
+            {
+                return false;
+            }
+            const char escaped = m_text[m_position++];
+            if(IsEscapedLiteral(escaped))
+            {
+                characters.set(static_cast<size_t>(escaped));
+            }
+            else if(nullptr != strchr("DWS", escaped))
+            {
+                ClassEscape(static_cast<char>(tolower(escaped)), &characters);
+                characters.flip();
+            }
+            else if(false == ClassEscape(escaped, &characters))
+            {
+                return false;
+            }
+        }
+        else if(IsLiteral(character))
+        {
+            characters.set(static_cast<size_t>(character));
+        }
+        else
+        {
+            return false;
+        }
+        const int start = NewState();
+        const int end = NewState();
+        m_states[start].characters = characters;
+        m_states[start].next = end;
+        *atom = {start, end};
+        return true;
+    }
+
+    // one member of a class, a character or an escape
+    bool ParseClassMember(CharSet *characters, char *character, bool *single)
+    {
+        if(AtEnd())
+        {
+            return false;
+        }
+        *character = m_text[m_position++];
+        *single = true;
+        if('[' == *character && false == AtEnd() && nullptr != strchr(":=.", m_text[m_position]))
+        {
+            // [:alpha:] and the like
+            return false;
+        }
+        if('\\' != *character)
+        {
+            return *character >= ' ' && *character < 127;
+        }
+        if(AtEnd())
+        {
+            return false;
+        }
+        *character = m_text[m_position++];
+        if(IsEscapedLiteral(*character))
+        {
+            return true;
+        }
+        *single = false;
+        return ClassEscape(*character, characters);
+    }
+
+    bool ParseClass(CharSet *characters)
+    {
+        bool negated = false;
+        if(false == AtEnd() && '^' == m_text[m_position])
+        {
+            negated = true;
+            ++m_position;
+        }
+        bool first = true;
+        while(true)
+        {
+            if(AtEnd())
+            {
+                return false;
+            }
+            if(']' == m_text[m_position] && false == first)
+            {
+                ++m_position;
+                break;
+            }
+            first = false;
+            char low = 0;
+            bool single = false;
+            if(false == ParseClassMember(characters, &low, &single))
+            {
+                return false;
+            }
+            if(false == single)
+            {
+                continue;
+            }
+            char high = low;
+            if(m_position+1 < m_text.size() && '-' == m_text[m_position] && ']' != m_text[m_position+1])
+            {
+                ++m_position;
+                if(false == ParseClassMember(characters, &high, &single) || false == single || high < low)
+                {
+                    return false;
+                }
+            }
+            for(int code = low; code <= high; ++code)
+            {
+                characters->set(static_cast<size_t>(code));
+            }
+        }
+        if(negated)
+        {
+            characters->flip();
+        }
+        return true;
+    }
+
+    string m_text;
+    size_t m_position;
+    vector<NfaState> m_states;
+};
+
+void EpsilonClosure(const vector<NfaState> &states, vector<int> *set)
+{
+    vector<char> reached(states.size(), 0);
+    vector<int> pending(*set);
+    set->clear();
+    while(false == pending.empty())
+    {
+        const int state = pending.back();
+        pending.pop_back();
+        if(0 != reached[state])
+        {
+            continue;
+        }
+        reached[state] = 1;
+        set->push_back(state);
+        for(const int next : states[state].epsilons)
+        {
+            pending.push_back(next);
+        }
+    }
+    std::sort(set->begin(), set->end());
+}
+
+// the literal text every match starts and ends with, given by the literal
+// characters before and after the first and last thing that is not one
+void FindLiteralAffixes(const string &expression, string *prefix, string *suffix)
+{
+    prefix->clear();
+    suffix->clear();
+    if(string::npos != expression.find("\\Q") || string::npos != expression.find("\\E"))
+    {
+        return;
+    }
+    // top level tokens, '\0' for anything that is not a literal character
+    string tokens;
+    size_t depth = 0;
+    size_t position = '^' == expression[0] ? 1 : 0;
+    size_t end = expression.size();
+    if(end > position && '$' == expression[end-1] && (end < 2 || '\\' != expression[end-2]))
+    {
+        --end;
+    }
+    while(end != position)
+    {
+        const char character = expression[position++];
+        if('\\' == character)
+        {
+            if(end == position)
+            {
+                return;
+            }
+            const char escaped = expression[position++];
+            // \x2E, \0101, \pL, \N{...}: how far a letter or digit escape
+            // goes is not known here, what follows may not be literal
+            if(0 != isalnum(static_cast<unsigned char>(escaped)))
+            {
+                return;
+            }
+            tokens.push_back(0 == depth && IsEscapedLiteral(escaped) ? escaped : '\0');
+        }
+        else if('[' == character)
+        {
+            // skip the class: a leading ']' and [:name:] are part of it
+            if(end != position && '^' == expression[position])
+            {
+                ++position;
+            }
+            if(end != position && ']' == expression[position])
+            {
+                ++position;
+            }
+            while(position < end && ']' != expression[position])
+            {
+                if('\\' == expression[position])
+                {
+                    position += 2;
+                    continue;
+                }
+                if('[' == expression[position] && position+1 < end &&
+                   nullptr != strchr(":=.", expression[position+1]))
+                {
+                    const char closing[] = {expression[position+1], ']', '\0'};
+                    const size_t found = expression.find(closing, position+2);
+                    if(string::npos == found || found >= end)
+                    {
+                        return;
+                    }
+                    position = found+2;
+                    continue;
+                }
+                ++position;
+            }
+            if(position >= end)
+            {
+                return;
+            }
+            ++position;
+            tokens.push_back('\0');
+        }
+        else if('(' == character)
+        {
+            if(end != position && '?' == expression[position] &&
+               (end == position+1 || ':' != expression[position+1]))
+            {
+                // inline options such as (?i) change what the literals match
+                return;
+            }
+            ++depth;
+            tokens.push_back('\0');
+        }
+        else if(')' == character)
+        {
+            if(0 == depth)
+            {
+                return;
+            }
+            --depth;
+            tokens.push_back('\0');
+        }
+        else if('|' == character && 0 == depth)
+        {
+            return;
+        }
+        else if(nullptr != strchr("*?{", character))
+        {
+            // the atom before may be missing from a match
+            if(false == tokens.empty())
+            {
+                tokens.back() = '\0';
+            }
+            tokens.push_back('\0');
+        }
+        else
+        {
+            tokens.push_back(0 == depth && IsLiteral(character) ? character : '\0');
+        }
+    }
+    const size_t prefixEnd = std::min(tokens.find('\0'), tokens.size());
+    prefix->assign(tokens, 0, prefixEnd);
+    if(tokens.size() != prefixEnd)
+    {
+        const size_t suffixBegin = tokens.find_last_of('\0')+1;
+        suffix->assign(tokens, suffixBegin, string::npos);
+    }
+}
+}
+
+ImagePattern::ImagePattern(const string &expression)
+    : m_regex(expression), m_compiled(false)
+{
+    FindLiteralAffixes(expression, &m_prefix, &m_suffix);
+    m_compiled = Compile(expression);
+}
+
+bool ImagePattern::Compiled() const
+{
+    return m_compiled;
+}
+
+bool ImagePattern::Compile(const string &expression)
+{
+    vector<NfaState> states;
+    int start = 0;
+    int accept = 0;
+    ExpressionParser parser(expression);
+    if(false == parser.Parse(&states, &start, &accept))
+    {
+        return false;
+    }
+    // subset construction, state 0 is the start
+    map<vector<int>, int32_t> dfaIds;
+    vector<vector<int>> dfaSets(1, vector<int>(1, start));
+    EpsilonClosure(states, &dfaSets[0]);
+    dfaIds[dfaSets[0]] = 0;
+    vector<vector<int>> targets(128);
+    for(size_t dfaState = 0; dfaSets.size() != dfaState; ++dfaState)
+    {
+        for(auto &target : targets)
+        {
+            target.clear();
+        }
+        bool accepting = false;
+        for(const int state : dfaSets[dfaState])
+        {
+            accepting = accepting || accept == state;
+            if(-1 == states[state].next)
+            {
+                continue;
+            }
+            for(size_t character = 0; 128 != character; ++character)
+            {
+                if(states[state].characters[character])
+                {
+                    targets[character].push_back(states[state].next);
+                }
+            }
+        }
+        m_accepting.push_back(accepting ? 1 : 0);
+        for(size_t character = 0; 128 != character; ++character)
+        {
+            int32_t nextDfaState = -1;
+            if(false == targets[character].empty())
+            {
+                EpsilonClosure(states, &targets[character]);
+                const auto idIter = dfaIds.find(targets[character]);
+                if(dfaIds.end() != idIter)
+                {
+                    nextDfaState = idIter->second;
+                }
+                else
+                {
+                    if(dfaSets.size() == g_maxDfaStates)
+                    {
+                        m_transitions.clear();
+                        m_accepting.clear();
+                        return false;
+                    }
+                    nextDfaState = static_cast<int32_t>(dfaSets.size());
+                    dfaIds[targets[character]] = nextDfaState;
+                    dfaSets.push_back(targets[character]);
+                }
+            }
+            m_transitions.push_back(nextDfaState);
+        }
+    }
+    return true;
+}
+
+bool ImagePattern::Match(const string &name) const
+{
+    if(name.size() < m_prefix.size()+m_suffix.size() ||
+       0 != name.compare(0, m_prefix.size(), m_prefix) ||
+       0 != name.compare(name.size()-m_suffix.size(), m_suffix.size(), m_suffix))
+    {
+        return false;
+    }
+    if(m_compiled)
+    {
+        int32_t state = 0;
+        size_t index = 0;
+        for(; name.size() != index; ++index)
+        {
+            const unsigned char character = static_cast<unsigned char>(name[index]);
+            if(character >= 128 || '\n' == character)
+            {
+                // left to boost
+                break;
+            }
+            state = m_transitions[static_cast<size_t>(state)*128+character];
+            if(state < 0)
+            {
+                return false;
+            }
+        }
+        if(name.size() == index)
+        {
+            return 0 != m_accepting[static_cast<size_t>(state)];
+        }
+    }
+    return boost::regex_match(name, m_regex);
+}
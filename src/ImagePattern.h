@@ -0,0 +1,47 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: ImagePattern
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_IMAGEPATTERN_H_
+#define COMMON_IMAGEPATTERN_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/regex.hpp>
+
+// the image selection expression, matched as boost::regex_match does but
+// analysed once: the literal prefix and suffix every match has ("DSC_" and
+// ".JPG" in DSC_.*\.JPG) are compared first, and an expression made only of
+// literals, classes, '.', groups, '|' and the * + ? quantifiers is compiled
+// to a DFA over the ASCII characters, the others and the names that are not
+// plain ASCII go through boost::regex
+class ImagePattern
+{
+public:
+    // throws boost::regex_error as boost::regex does
+    explicit ImagePattern(const std::string &expression);
+
+    bool Match(const std::string &name) const;
+    // the DFA could be built
+    bool Compiled() const;
+
+private:
+    bool Compile(const std::string &expression);
+
+    boost::regex m_regex;
+    std::string m_prefix;
+    std::string m_suffix;
+    // m_transitions[state*128+character], -1 when nothing can match any more
+    std::vector<int32_t> m_transitions;
+    std::vector<char> m_accepting;
+    bool m_compiled;
+};
+
+#endif // COMMON_IMAGEPATTERN_H_
@@ -0,0 +1,140 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: ImageSizeCache
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ImageSizeCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "FileContent.h"
+
+using std::string;
+using std::vector;
+
+namespace
+{
+// file layout, in the byte order of the machine that wrote it:
+// header {magic, version, entry count}
+// then per entry {fileSize, mtimeSeconds, mtimeNanoseconds, inode,
+//                 width, height, path length, 0} and the path bytes
+// a file of another version or byte order fails the magic test
+// and is rebuilt from scratch
+constexpr uint32_t g_cacheMagic = 0x5a534947; // "GISZ"
+constexpr uint32_t g_cacheVersion = 1;
+constexpr size_t g_headerSize = 16;
+constexpr size_t g_entrySize = 48;
+}
+
+ImageSizeCache::ImageSizeCache(const string &cacheFilePath)
+    : m_cacheFilePath(cacheFilePath), m_modified(false)
+{
+}
+
+void ImageSizeCache::Load()
+{
+    m_entries.clear();
+    m_modified = false;
+    vector<char> content;
+    if(false == ReadWholeFile(m_cacheFilePath, &content) || content.size() < g_headerSize ||
+       g_cacheMagic != ReadValue<uint32_t>(content.data()) ||
+       g_cacheVersion != ReadValue<uint32_t>(content.data()+4))
+    {
+        return;
+    }
+    const uint64_t entryCount = ReadValue<uint64_t>(content.data()+8);
+    size_t offset = g_headerSize;
+    for(uint64_t entryIndex = 0; entryCount != entryIndex; ++entryIndex)
+    {
+        if(content.size()-offset < g_entrySize)
+        {
+            break;
+        }
+        const char *bytes = content.data()+offset;
+        Entry entry;
+        entry.key.fileSize = ReadValue<uint64_t>(bytes);
+        entry.key.mtimeSeconds = ReadValue<int64_t>(bytes+8);
+        entry.key.mtimeNanoseconds = ReadValue<int64_t>(bytes+16);
+        entry.key.inode = ReadValue<uint64_t>(bytes+24);
+        entry.width = ReadValue<uint32_t>(bytes+32);
+        entry.height = ReadValue<uint32_t>(bytes+36);
+        const uint32_t pathLength = ReadValue<uint32_t>(bytes+40);
+        offset += g_entrySize;
+        if(content.size()-offset < pathLength)
+        {
+            // truncated, keep what was complete
+            break;
+        }
+        m_entries[string(content.data()+offset, pathLength)] = entry;
+        offset += pathLength;
+    }
+}
+
+bool ImageSizeCache::Find(const string &relativePath, const FileKey &key,
+                          size_t *width, size_t *height) const
+{
+    const auto entryIter = m_entries.find(relativePath);
+    if(m_entries.end() == entryIter || entryIter->second.key != key)
+    {
+        return false;
+    }
+    *width = entryIter->second.width;
+    *height = entryIter->second.height;
+    return true;
+}
+
+void ImageSizeCache::Insert(const string &relativePath, const FileKey &key,
+                            size_t width, size_t height)
+{
+    Entry entry;
+    entry.key = key;
+    entry.width = static_cast<uint32_t>(width);
+    entry.height = static_cast<uint32_t>(height);
+    const auto entryIter = m_entries.find(relativePath);
+    if(m_entries.end() != entryIter && entryIter->second.key == key &&
+       entryIter->second.width == entry.width && entryIter->second.height == entry.height)
+    {
+        return;
+    }
+    m_entries[relativePath] = entry;
+    m_modified = true;
+}
+
+bool ImageSizeCache::Save()
+{
+    if(false == m_modified)
+    {
+        return true;
+    }
+    vector<char> content;
+    content.reserve(g_headerSize+m_entries.size()*(g_entrySize+32));
+    AppendValue<uint32_t>(g_cacheMagic, &content);
+    AppendValue<uint32_t>(g_cacheVersion, &content);
+    AppendValue<uint64_t>(m_entries.size(), &content);
+    for(const auto &record : m_entries)
+    {
+        const Entry &entry = record.second;
+        AppendValue<uint64_t>(entry.key.fileSize, &content);
+        AppendValue<int64_t>(entry.key.mtimeSeconds, &content);
+        AppendValue<int64_t>(entry.key.mtimeNanoseconds, &content);
+        AppendValue<uint64_t>(entry.key.inode, &content);
+        AppendValue<uint32_t>(entry.width, &content);
+        AppendValue<uint32_t>(entry.height, &content);
+        AppendValue<uint32_t>(static_cast<uint32_t>(record.first.size()), &content);
+        AppendValue<uint32_t>(0, &content);
+        content.insert(content.end(), record.first.begin(), record.first.end());
+    }
+
+    if(false == ReplaceFileContent(m_cacheFilePath, content))
+    {
+        return false;
+    }
+    m_modified = false;
+    return true;
+}
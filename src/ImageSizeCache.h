@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: ImageSizeCache
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_IMAGESIZECACHE_H_
+#define COMMON_IMAGESIZECACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "FileKey.h"
+
+// image sizes of the previous runs, stored in one binary file of the dataset
+// Load and Save are for one thread, Find may be called by any number of
+// threads at once as long as no Insert runs
+class ImageSizeCache
+{
+public:
+    explicit ImageSizeCache(const std::string &cacheFilePath);
+
+    // a missing or unreadable cache file is an empty cache
+    void Load();
+    // the size of relativePath when it was cached with the same key
+    bool Find(const std::string &relativePath, const FileKey &key,
+              size_t *width, size_t *height) const;
+    void Insert(const std::string &relativePath, const FileKey &key,
+                size_t width, size_t height);
+    // rewrite the cache file if Insert changed anything, the new content
+    // is written beside it then renamed over it, readers never see half a file
+    bool Save();
+
+private:
+    struct Entry
+    {
+        FileKey key;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    std::string m_cacheFilePath;
+    std::unordered_map<std::string, Entry> m_entries;
+    bool m_modified;
+};
+
+#endif // COMMON_IMAGESIZECACHE_H_
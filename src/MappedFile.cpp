@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: MappedFile
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#include <cstdio>
+
+#include <boost/predef/os.h>
+
+#if BOOST_OS_WINDOWS == 0
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "FileContent.h"
+
+using std::string;
+
+MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0), m_mappedSize(0)
+{}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Close()
+{
+#if BOOST_OS_WINDOWS == 0
+    if(0 != m_mappedSize)
+    {
+        munmap(m_data, m_mappedSize);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mappedSize = 0;
+    std::vector<char>().swap(m_buffer);
+}
+
+bool MappedFile::Open(const string &filePath)
+{
+    Close();
+#if BOOST_OS_WINDOWS == 0
+    const int fd = open(filePath.c_str(), O_RDONLY|O_CLOEXEC);
+    if(-1 == fd)
+    {
+        return false;
+    }
+    struct stat fileStat;
+    if(0 != fstat(fd, &fileStat) || false == S_ISREG(fileStat.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+    const size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    // the file pages then one more: the kernel fills the end of the last file
+    // page with zeros, and when the file ends on a page boundary the zero comes
+    // from the anonymous page behind it, reading past the file would fault
+    const size_t mappedSize = (fileSize/pageSize+1)*pageSize;
+    void *reserved = mmap(nullptr, mappedSize, PROT_READ|PROT_WRITE,
+                          MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(MAP_FAILED == reserved)
+    {
+        close(fd);
+        return false;
+    }
+    if(0 != fileSize &&
+       MAP_FAILED == mmap(reserved, fileSize, PROT_READ|PROT_WRITE,
+                          MAP_PRIVATE|MAP_FIXED, fd, 0))
+    {
+        munmap(reserved, mappedSize);
+        close(fd);
+        return false;
+    }
+    // the mapping keeps the file, not the descriptor
+    close(fd);
+    if(0 != fileSize)
+    {
+        madvise(reserved, fileSize, MADV_SEQUENTIAL);
+    }
+    m_data = static_cast<char*>(reserved);
+    m_size = fileSize;
+    m_mappedSize = mappedSize;
+    return true;
+#else
+    if(false == ReadWholeFile(filePath, &m_buffer))
+    {
+        return false;
+    }
+    m_size = m_buffer.size();
+    m_buffer.push_back('\0');
+    m_data = m_buffer.data();
+    return true;
+#endif
+}
+
+char* MappedFile::Data()
+{
+    return m_data;
+}
+
+size_t MappedFile::Size() const
+{
+    return m_size;
+}
@@ -0,0 +1,46 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: MappedFile
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_MAPPEDFILE_H_
+#define COMMON_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// the content of a file, writable and followed by a zero byte, for the
+// parsers that work in place (rapidxml) and keep pointers into the text
+// on POSIX the file is mapped copy-on-write (MAP_PRIVATE): nothing is copied
+// up front and the writes never reach the file, elsewhere it is read
+// the content lives as long as the object, so keep it beside the document
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string &filePath);
+    // Size() bytes then '\0', nullptr before Open
+    char* Data();
+    size_t Size() const;
+
+private:
+    void Close();
+
+    char *m_data;
+    size_t m_size;
+    // length of the mapping, 0 when the content is in m_buffer
+    size_t m_mappedSize;
+    std::vector<char> m_buffer;
+};
+
+#endif // COMMON_MAPPEDFILE_H_
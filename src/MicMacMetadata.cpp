@@ -0,0 +1,111 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the functions: ScanMicMacMetadata
+// and ReadMicMacMetadataSize
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "MicMacMetadata.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "rapidxml.hpp"
+#include "FileContent.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::set;
+
+using boost::filesystem::path;
+using boost::filesystem::directory_iterator;
+using boost::system::error_code;
+
+using rapidxml::xml_document;
+using rapidxml::xml_node;
+
+namespace
+{
+const char* const g_metadataTag = "-MDT-";
+const char* const g_metadataExtension = ".xml";
+}
+
+void ScanMicMacMetadata(const string &tmpMmDirPath, const set<string> &imageNames,
+                        map<string, string> *metadataFiles)
+{
+    metadataFiles->clear();
+    error_code errorCode;
+    directory_iterator iter(path(tmpMmDirPath), errorCode);
+    if(errorCode)
+    {
+        return;
+    }
+    const string extension(g_metadataExtension);
+    for(const directory_iterator end; end != iter; iter.increment(errorCode))
+    {
+        if(errorCode)
+        {
+            break;
+        }
+        const string fileName = iter->path().filename().string();
+        // DSC_6443.JPG-MDT-4226.xml
+        const size_t tagIndex = fileName.rfind(g_metadataTag);
+        if(string::npos == tagIndex || fileName.size() < extension.size() ||
+           0 != fileName.compare(fileName.size()-extension.size(), extension.size(), extension))
+        {
+            continue;
+        }
+        const string imageName(fileName, 0, tagIndex);
+        if(imageNames.end() != imageNames.find(imageName))
+        {
+            (*metadataFiles)[imageName] = iter->path().string();
+        }
+    }
+}
+
+bool ReadMicMacMetadataSize(const string &metadataFilePath, size_t *width, size_t *height)
+{
+    vector<char> content;
+    if(false == ReadWholeFile(metadataFilePath, &content))
+    {
+        return false;
+    }
+    // rapidxml parses a zero terminated string in place
+    content.push_back('\0');
+    try
+    {
+        xml_document<> metadataXml;
+        metadataXml.parse<rapidxml::parse_no_utf8>(content.data());
+        const xml_node<> *xifInfo = metadataXml.first_node("XmlXifInfo");
+        const xml_node<> *size = nullptr == xifInfo ? nullptr : xifInfo->first_node("Sz");
+        if(nullptr == size)
+        {
+            return false;
+        }
+        // <Sz>6000 4000</Sz>
+        const string text(size->value(), size->value()+size->value_size());
+        char *end = nullptr;
+        const long sizeX = strtol(text.c_str(), &end, 10);
+        const long sizeY = strtol(end, nullptr, 10);
+        if(sizeX <= 0 || sizeY <= 0)
+        {
+            return false;
+        }
+        *width = static_cast<size_t>(sizeX);
+        *height = static_cast<size_t>(sizeY);
+        return true;
+    }
+    catch(const rapidxml::parse_error&)
+    {
+        return false;
+    }
+}
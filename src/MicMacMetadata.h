@@ -0,0 +1,30 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the functions: ScanMicMacMetadata
+// and ReadMicMacMetadataSize
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_MICMACMETADATA_H_
+#define COMMON_MICMACMETADATA_H_
+
+#include <cstddef>
+#include <string>
+#include <map>
+#include <set>
+
+// the metadata files MicMac keeps in Tmp-MM-Dir, "<image>-MDT-<n>.xml",
+// of the images of imageNames, found with one scan of the directory
+// metadataFiles maps an image name to its file, empty without Tmp-MM-Dir
+void ScanMicMacMetadata(const std::string &tmpMmDirPath,
+                        const std::set<std::string> &imageNames,
+                        std::map<std::string, std::string> *metadataFiles);
+
+// the Sz of the XmlXifInfo in metadataFilePath
+bool ReadMicMacMetadataSize(const std::string &metadataFilePath,
+                            size_t *width, size_t *height);
+
+#endif // COMMON_MICMACMETADATA_H_
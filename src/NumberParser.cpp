@@ -0,0 +1,147 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ParseDouble
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "NumberParser.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+// the powers of ten a double holds exactly
+const double g_exactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+constexpr int g_maxExactPower = 22;
+// every integer up to 2^53 is a double
+constexpr uint64_t g_maxExactMantissa = uint64_t(1) << 53;
+constexpr int g_maxMantissaDigits = 19;
+
+bool IsDigit(char character)
+{
+    return character >= '0' && character <= '9';
+}
+
+// the slow path: strtod on a zero terminated copy
+const char* ParseWithStrtod(const char *begin, const char *end, double *value)
+{
+    char stackBuffer[128];
+    std::string heapBuffer;
+    const size_t length = static_cast<size_t>(end-begin);
+    const char *text = stackBuffer;
+    if(length < sizeof(stackBuffer))
+    {
+        memcpy(stackBuffer, begin, length);
+        stackBuffer[length] = '\0';
+    }
+    else
+    {
+        heapBuffer.assign(begin, end);
+        text = heapBuffer.c_str();
+    }
+    // no white space skipping, as on the fast path
+    if(0 != length && (' ' == text[0] || (text[0] >= '\t' && text[0] <= '\r')))
+    {
+        *value = 0.0;
+        return begin;
+    }
+    char *numberEnd = nullptr;
+    *value = strtod(text, &numberEnd);
+    return begin+(numberEnd-text);
+}
+}
+
+const char* ParseDouble(const char *begin, const char *end, double *value)
+{
+    const char *current = begin;
+    const bool negative = end != current && '-' == *current;
+    if(end != current && ('-' == *current || '+' == *current))
+    {
+        ++current;
+    }
+    // the mantissa digits without the leading zeros, the decimal
+    // exponent counts the fraction digits and the ones left out
+    uint64_t mantissa = 0;
+    int digitCount = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    while(end != current && IsDigit(*current))
+    {
+        anyDigit = true;
+        if(0 != mantissa || '0' != *current)
+        {
+            if(digitCount == g_maxMantissaDigits)
+            {
+                return ParseWithStrtod(begin, end, value);
+            }
+            mantissa = mantissa*10+static_cast<uint64_t>(*current-'0');
+            ++digitCount;
+        }
+        ++current;
+    }
+    if(end != current && '.' == *current)
+    {
+        ++current;
+        while(end != current && IsDigit(*current))
+        {
+            anyDigit = true;
+            if(0 != mantissa || '0' != *current)
+            {
+                if(digitCount == g_maxMantissaDigits)
+                {
+                    return ParseWithStrtod(begin, end, value);
+                }
+                mantissa = mantissa*10+static_cast<uint64_t>(*current-'0');
+                ++digitCount;
+            }
+            --exponent;
+            ++current;
+        }
+    }
+    if(false == anyDigit || (end != current && ('x' == *current || 'X' == *current)))
+    {
+        // inf, nan, hexadecimal or no number at all
+        return ParseWithStrtod(begin, end, value);
+    }
+    if(end != current && ('e' == *current || 'E' == *current))
+    {
+        const char *exponentBegin = current+1;
+        const bool negativeExponent = end != exponentBegin && '-' == *exponentBegin;
+        if(end != exponentBegin && ('-' == *exponentBegin || '+' == *exponentBegin))
+        {
+            ++exponentBegin;
+        }
+        if(end != exponentBegin && IsDigit(*exponentBegin))
+        {
+            int exponentValue = 0;
+            for(current = exponentBegin; end != current && IsDigit(*current); ++current)
+            {
+                if(exponentValue < 100000)
+                {
+                    exponentValue = exponentValue*10+(*current-'0');
+                }
+            }
+            exponent += negativeExponent ? -exponentValue : exponentValue;
+        }
+        // else "1e" or "1e+", the number ends before the 'e' as for strtod
+    }
+    if(mantissa > g_maxExactMantissa || exponent < -g_maxExactPower || exponent > g_maxExactPower)
+    {
+        return ParseWithStrtod(begin, end, value);
+    }
+    // both operands are exact, so the one rounding of the
+    // product or quotient gives the correctly rounded result
+    double result = static_cast<double>(mantissa);
+    result = exponent < 0 ? result/g_exactPowers[-exponent] : result*g_exactPowers[exponent];
+    *value = negative ? -result : result;
+    return current;
+}
@@ -0,0 +1,22 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ParseDouble
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_NUMBERPARSER_H_
+#define COMMON_NUMBERPARSER_H_
+
+// read the decimal number at the start of [begin, end) into *value,
+// as strtod does in the "C" locale but without leading white space,
+// allocation or zero terminated text
+// returns the end of the number, begin (and *value = 0) when there is none
+// the usual numbers (up to 19 significant digits, exponent within 10^22)
+// are converted directly, the others go through strtod, both give
+// the correctly rounded double
+const char* ParseDouble(const char *begin, const char *end, double *value);
+
+#endif // COMMON_NUMBERPARSER_H_
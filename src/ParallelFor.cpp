@@ -0,0 +1,86 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: ParallelFor
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ParallelFor.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+using std::vector;
+using std::thread;
+using std::atomic;
+using std::function;
+using std::exception_ptr;
+
+unsigned DefaultThreadCount()
+{
+    const unsigned hardwareCount = thread::hardware_concurrency();
+    // hardware_concurrency is allowed to answer 0 when it does not know
+    return 0 == hardwareCount ? 1 : hardwareCount;
+}
+
+void ParallelFor(size_t count, unsigned threadCount,
+                 function<void(size_t, unsigned)> taskFunc)
+{
+    if(threadCount > count)
+    {
+        threadCount = static_cast<unsigned>(count);
+    }
+    if(threadCount <= 1)
+    {
+        // no need to pay for a thread
+        for(size_t index = 0; count != index; ++index)
+        {
+            taskFunc(index, 0);
+        }
+        return;
+    }
+    // hand out the indices one by one, an image that takes long
+    // does not hold back the ones queued behind it
+    atomic<size_t> nextIndex(0);
+    std::mutex errorMutex;
+    exception_ptr firstError;
+    const auto worker = [&](unsigned workerIndex)
+    {
+        try
+        {
+            for(size_t index = nextIndex++; index < count; index = nextIndex++)
+            {
+                taskFunc(index, workerIndex);
+            }
+        }
+        catch(...)
+        {
+            // stop handing out work and report the error to the caller
+            nextIndex = count;
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if(!firstError)
+            {
+                firstError = std::current_exception();
+            }
+        }
+    };
+    vector<thread> workers;
+    workers.reserve(threadCount);
+    for(unsigned workerIndex = 0; threadCount != workerIndex; ++workerIndex)
+    {
+        workers.emplace_back(worker, workerIndex);
+    }
+    for(auto &workerThread : workers)
+    {
+        workerThread.join();
+    }
+    if(firstError)
+    {
+        std::rethrow_exception(firstError);
+    }
+}
@@ -0,0 +1,25 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: ParallelFor
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_PARALLELFOR_H_
+#define COMMON_PARALLELFOR_H_
+
+#include <cstddef>
+#include <functional>
+
+// number of worker threads used when the user does not ask for one
+unsigned DefaultThreadCount();
+
+// call taskFunc(index, workerIndex) for every index in [0, count)
+// on at most threadCount threads, workerIndex is in [0, threadCount)
+// and is stable for a thread, so it can select thread-local storage
+void ParallelFor(size_t count, unsigned threadCount,
+                 std::function<void(size_t, unsigned)> taskFunc);
+
+#endif // COMMON_PARALLELFOR_H_
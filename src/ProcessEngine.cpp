@@ -0,0 +1,536 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the class: ProcessEngine
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProcessEngine.h"
+#include "ProcessInvoke.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <exception>
+
+#include <boost/predef/os.h>
+
+#if BOOST_OS_LINUX != 0
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#else
+#include <condition_variable>
+#endif
+
+using std::string;
+using std::vector;
+using std::function;
+using std::future;
+using std::promise;
+using std::deque;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::exception_ptr;
+
+namespace
+{
+struct Command
+{
+    string binPath;
+    vector<string> param;
+    function<void(const char*)> cmdCallback;
+    // see ProcessEngine::SubmitWithResult
+    int inputFd = -1;
+    function<void(const char*, size_t)> resultCallback;
+    promise<int> result;
+};
+}
+
+#if BOOST_OS_LINUX != 0
+namespace
+{
+// epoll keys: child id shifted by two, the low bits tell which descriptor
+constexpr uint64_t g_wakeKey = UINT64_MAX;
+constexpr uint64_t g_outputKey = 0;
+constexpr uint64_t g_pidKey = 1;
+constexpr uint64_t g_resultKey = 2;
+
+struct RunningChild
+{
+    Command command;
+    pid_t pid;
+    int outputFd;
+    // -1 without resultCallback
+    int resultFd;
+    int pidFd;
+    // text after the last '\n', waiting for the rest of the line
+    string pendingLine;
+    bool exited;
+    int exitStatus;
+    exception_ptr error;
+};
+
+int OpenPidFd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+int ExitStatusOf(int status)
+{
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+}
+
+class ProcessEngine::Impl
+{
+public:
+    explicit Impl(unsigned maxRunning)
+        : m_maxRunning(0 == maxRunning ? 1 : maxRunning), m_nextId(0), m_stopping(false)
+    {
+        m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = g_wakeKey;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &event);
+        m_loopThread = thread(&Impl::Loop, this);
+    }
+    ~Impl()
+    {
+        {
+            lock_guard<mutex> lock(m_pendingMutex);
+            m_stopping = true;
+        }
+        Wake();
+        m_loopThread.join();
+        close(m_wakeFd);
+        close(m_epollFd);
+    }
+    future<int> Submit(Command &&command)
+    {
+        future<int> result = command.result.get_future();
+        {
+            lock_guard<mutex> lock(m_pendingMutex);
+            m_pending.push_back(std::move(command));
+        }
+        Wake();
+        return result;
+    }
+
+private:
+    void Wake()
+    {
+        const uint64_t one = 1;
+        // the counter only has to become non zero, a full counter is fine
+        (void)!write(m_wakeFd, &one, sizeof(one));
+    }
+
+    void Loop()
+    {
+        epoll_event events[64];
+        while(true)
+        {
+            if(false == StartPending())
+            {
+                break;
+            }
+            const int eventCount = epoll_wait(m_epollFd, events, 64, -1);
+            if(eventCount < 0)
+            {
+                if(EINTR == errno)
+                {
+                    continue;
+                }
+                break;
+            }
+            for(int index = 0; eventCount != index; ++index)
+            {
+                const uint64_t key = events[index].data.u64;
+                if(g_wakeKey == key)
+                {
+                    uint64_t counter = 0;
+                    (void)!read(m_wakeFd, &counter, sizeof(counter));
+                    continue;
+                }
+                const auto childIter = m_running.find(key >> 2);
+                if(m_running.end() == childIter)
+                {
+                    continue;
+                }
+                RunningChild &child = childIter->second;
+                if(g_pidKey == (key & 3))
+                {
+                    ReapChild(&child);
+                }
+                else if(g_resultKey == (key & 3))
+                {
+                    DrainResult(&child);
+                }
+                else
+                {
+                    DrainOutput(&child);
+                }
+                if(-1 == child.outputFd && -1 == child.resultFd && child.exited)
+                {
+                    if(child.error)
+                    {
+                        child.command.result.set_exception(child.error);
+                    }
+                    else
+                    {
+                        child.command.result.set_value(child.exitStatus);
+                    }
+                    m_running.erase(childIter);
+                }
+            }
+        }
+    }
+
+    // start queued commands up to the limit
+    // returns false once the engine is stopping and nothing is left to do
+    bool StartPending()
+    {
+        deque<Command> toStart;
+        {
+            lock_guard<mutex> lock(m_pendingMutex);
+            while(m_running.size()+toStart.size() < m_maxRunning && false == m_pending.empty())
+            {
+                toStart.push_back(std::move(m_pending.front()));
+                m_pending.pop_front();
+            }
+            if(toStart.empty() && m_running.empty() && m_stopping && m_pending.empty())
+            {
+                return false;
+            }
+        }
+        for(auto &command : toStart)
+        {
+            vector<std::pair<int, int>> childFds;
+            int resultPipe[2] = {-1, -1};
+            if(command.resultCallback)
+            {
+                if(0 != pipe2(resultPipe, O_CLOEXEC))
+                {
+                    command.result.set_value(-1);
+                    continue;
+                }
+                childFds.push_back(std::make_pair(resultPipe[1], g_childResultFd));
+            }
+            if(-1 != command.inputFd)
+            {
+                childFds.push_back(std::make_pair(command.inputFd, g_childInputFd));
+            }
+            pid_t pid = 0;
+            int outputFd = -1;
+            const bool spawned = SpawnWithOutputPipe(command.binPath, command.param, childFds,
+                                                     &pid, &outputFd);
+            if(-1 != resultPipe[1])
+            {
+                // only the child writes, the read sees EOF once it exited
+                close(resultPipe[1]);
+            }
+            if(false == spawned)
+            {
+                if(-1 != resultPipe[0])
+                {
+                    close(resultPipe[0]);
+                }
+                command.result.set_value(-1);
+                continue;
+            }
+            fcntl(outputFd, F_SETFL, fcntl(outputFd, F_GETFL)|O_NONBLOCK);
+            const uint64_t id = m_nextId++;
+            RunningChild &child = m_running[id];
+            child.command = std::move(command);
+            child.pid = pid;
+            child.outputFd = outputFd;
+            child.resultFd = resultPipe[0];
+            child.pidFd = OpenPidFd(pid);
+            child.exited = false;
+            child.exitStatus = -1;
+
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u64 = (id << 2)|g_outputKey;
+            epoll_ctl(m_epollFd, EPOLL_CTL_ADD, outputFd, &event);
+            if(-1 != child.resultFd)
+            {
+                fcntl(child.resultFd, F_SETFL, fcntl(child.resultFd, F_GETFL)|O_NONBLOCK);
+                event.data.u64 = (id << 2)|g_resultKey;
+                epoll_ctl(m_epollFd, EPOLL_CTL_ADD, child.resultFd, &event);
+            }
+            if(-1 != child.pidFd)
+            {
+                event.data.u64 = (id << 2)|g_pidKey;
+                epoll_ctl(m_epollFd, EPOLL_CTL_ADD, child.pidFd, &event);
+            }
+        }
+        return true;
+    }
+
+    // run a callback of child, the first exception is kept for its future
+    template<typename Callback>
+    void Deliver(RunningChild *child, Callback callback)
+    {
+        if(child->error)
+        {
+            return;
+        }
+        try
+        {
+            callback();
+        }
+        catch(...)
+        {
+            child->error = std::current_exception();
+        }
+    }
+
+    // read everything fd holds now into consume(data, size)
+    // returns true once the writers are gone (end of file)
+    template<typename Consumer>
+    bool ReadAvailable(int fd, Consumer consume)
+    {
+        char buffer[4096];
+        while(true)
+        {
+            const ssize_t byteRead = read(fd, buffer, sizeof(buffer));
+            if(byteRead < 0)
+            {
+                if(EINTR == errno)
+                {
+                    continue;
+                }
+                if(EAGAIN == errno || EWOULDBLOCK == errno)
+                {
+                    return false;
+                }
+            }
+            if(byteRead <= 0)
+            {
+                return true;
+            }
+            consume(buffer, static_cast<size_t>(byteRead));
+        }
+    }
+
+    void CloseChildFd(int *fd)
+    {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, *fd, nullptr);
+        close(*fd);
+        *fd = -1;
+    }
+
+    // no pidfd on this kernel: once every pipe is closed
+    // the child is about to exit anyway
+    void WaitWithoutPidFd(RunningChild *child)
+    {
+        if(-1 != child->pidFd || -1 != child->outputFd || -1 != child->resultFd)
+        {
+            return;
+        }
+        int status = 0;
+        WaitSpawnedChild(child->pid, &status, 0);
+        child->exited = true;
+        child->exitStatus = ExitStatusOf(status);
+    }
+
+    void DrainOutput(RunningChild *child)
+    {
+        const bool ended = ReadAvailable(child->outputFd, [this, child](const char *data, size_t size)
+        {
+            const char *begin = data;
+            const char* const end = data+size;
+            for(const char *newLine = std::find(begin, end, '\n'); end != newLine;
+                newLine = std::find(begin, end, '\n'))
+            {
+                child->pendingLine.append(begin, newLine+1);
+                Deliver(child, [child]{child->command.cmdCallback(child->pendingLine.c_str());});
+                child->pendingLine.clear();
+                begin = newLine+1;
+            }
+            child->pendingLine.append(begin, end);
+        });
+        if(false == ended)
+        {
+            return;
+        }
+        if(false == child->pendingLine.empty())
+        {
+            Deliver(child, [child]{child->command.cmdCallback(child->pendingLine.c_str());});
+            child->pendingLine.clear();
+        }
+        CloseChildFd(&child->outputFd);
+        WaitWithoutPidFd(child);
+    }
+
+    void DrainResult(RunningChild *child)
+    {
+        const bool ended = ReadAvailable(child->resultFd, [this, child](const char *data, size_t size)
+        {
+            Deliver(child, [child, data, size]{child->command.resultCallback(data, size);});
+        });
+        if(ended)
+        {
+            CloseChildFd(&child->resultFd);
+            WaitWithoutPidFd(child);
+        }
+    }
+
+    void ReapChild(RunningChild *child)
+    {
+        int status = 0;
+        if(0 == WaitSpawnedChild(child->pid, &status, WNOHANG))
+        {
+            return;
+        }
+        child->exited = true;
+        child->exitStatus = ExitStatusOf(status);
+        CloseChildFd(&child->pidFd);
+    }
+
+    const size_t m_maxRunning;
+    int m_epollFd;
+    int m_wakeFd;
+    uint64_t m_nextId;
+    // only touched by the loop thread
+    std::map<uint64_t, RunningChild> m_running;
+
+    mutex m_pendingMutex;
+    deque<Command> m_pending;
+    bool m_stopping;
+
+    thread m_loopThread;
+};
+#else
+// no epoll here: a few threads run the commands with ProcessInvoke
+class ProcessEngine::Impl
+{
+public:
+    explicit Impl(unsigned maxRunning)
+        : m_stopping(false)
+    {
+        for(unsigned index = 0; (0 == maxRunning ? 1 : maxRunning) != index; ++index)
+        {
+            m_workers.emplace_back(&Impl::Work, this);
+        }
+    }
+    ~Impl()
+    {
+        {
+            lock_guard<mutex> lock(m_pendingMutex);
+            m_stopping = true;
+        }
+        m_pendingCondition.notify_all();
+        for(auto &worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+    future<int> Submit(Command &&command)
+    {
+        future<int> result = command.result.get_future();
+        {
+            lock_guard<mutex> lock(m_pendingMutex);
+            m_pending.push_back(std::move(command));
+        }
+        m_pendingCondition.notify_one();
+        return result;
+    }
+
+private:
+    void Work()
+    {
+        while(true)
+        {
+            Command command;
+            {
+                std::unique_lock<mutex> lock(m_pendingMutex);
+                m_pendingCondition.wait(lock, [this]{return m_stopping || false == m_pending.empty();});
+                if(m_pending.empty())
+                {
+                    return;
+                }
+                command = std::move(m_pending.front());
+                m_pending.pop_front();
+            }
+            try
+            {
+                ProcessInvoke("", command.binPath, command.param, command.cmdCallback);
+                command.result.set_value(0);
+            }
+            catch(...)
+            {
+                command.result.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    mutex m_pendingMutex;
+    std::condition_variable m_pendingCondition;
+    deque<Command> m_pending;
+    bool m_stopping;
+    vector<thread> m_workers;
+};
+#endif
+
+ProcessEngine::ProcessEngine(unsigned maxRunning)
+    : m_impl(new Impl(maxRunning))
+{}
+
+ProcessEngine::~ProcessEngine()
+{}
+
+future<int> ProcessEngine::Submit(const string &binPath, const vector<string> &param,
+                                  function<void(const char*)> cmdCallback)
+{
+    Command command;
+    command.binPath = binPath;
+    command.param = param;
+    command.cmdCallback = std::move(cmdCallback);
+    return m_impl->Submit(std::move(command));
+}
+
+bool ProcessEngine::HasChildDescriptors()
+{
+#if BOOST_OS_LINUX != 0
+    return true;
+#else
+    return false;
+#endif
+}
+
+future<int> ProcessEngine::SubmitWithResult(const string &binPath, const vector<string> &param,
+                                            function<void(const char*)> cmdCallback,
+                                            int inputFd,
+                                            function<void(const char*, size_t)> resultCallback)
+{
+    Command command;
+    command.binPath = binPath;
+    command.param = param;
+    command.cmdCallback = std::move(cmdCallback);
+#if BOOST_OS_LINUX != 0
+    command.inputFd = inputFd;
+    command.resultCallback = std::move(resultCallback);
+#else
+    (void)inputFd;
+    (void)resultCallback;
+#endif
+    return m_impl->Submit(std::move(command));
+}
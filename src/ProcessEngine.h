@@ -0,0 +1,66 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the class: ProcessEngine
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_PROCESSENGINE_H_
+#define COMMON_PROCESSENGINE_H_
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <future>
+#include <memory>
+
+// descriptors a command of SubmitWithResult finds open besides 0, 1 and 2
+constexpr int g_childResultFd = 3;
+constexpr int g_childInputFd = 4;
+
+// run many commands at once without a thread per command
+// on Linux one thread watches every running child with epoll
+// (output pipes and pidfds), elsewhere a few threads call ProcessInvoke
+class ProcessEngine
+{
+public:
+    // at most maxRunning children are alive at the same time,
+    // the other commands wait in submission order
+    explicit ProcessEngine(unsigned maxRunning);
+    // waits for every submitted command
+    ~ProcessEngine();
+
+    ProcessEngine(const ProcessEngine&) = delete;
+    ProcessEngine& operator=(const ProcessEngine&) = delete;
+
+    // queue binPath(absolute path, see ResolveBinaryPath) with param
+    // cmdCallback receives every output line on the engine thread,
+    // the future gives the exit status (-1 when the command cannot run)
+    // once the child exited and its output is drained
+    std::future<int> Submit(const std::string &binPath,
+                            const std::vector<std::string> &param,
+                            std::function<void(const char*)> cmdCallback);
+
+    // true where SubmitWithResult gives the child its extra descriptors (Linux)
+    static bool HasChildDescriptors();
+
+    // as Submit, and in the child:
+    // g_childResultFd is the write end of a pipe, what the child writes into
+    // "/proc/self/fd/3" goes to resultCallback on the engine thread, no file involved
+    // g_childInputFd is a copy of inputFd unless it is -1, e.g. a memfd every
+    // command reads as "/proc/self/fd/4", inputFd must stay open until the future is ready
+    // where HasChildDescriptors() is false, inputFd and resultCallback are ignored
+    std::future<int> SubmitWithResult(const std::string &binPath,
+                                      const std::vector<std::string> &param,
+                                      std::function<void(const char*)> cmdCallback,
+                                      int inputFd,
+                                      std::function<void(const char*, size_t)> resultCallback);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+#endif // COMMON_PROCESSENGINE_H_
@@ -12,15 +12,25 @@
 #undef __STRICT_ANSI__
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
-#include <random>
-#include <ctime>
-#include <climits>
-
+#include <boost/predef/os.h>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
-#include <boost/lexical_cast.hpp>
+
+#if BOOST_OS_WINDOWS == 0
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <mutex>
+#include <set>
+extern char **environ;
+#endif
 
 using std::string;
 using std::vector;
@@ -30,10 +40,50 @@ using boost::filesystem::path;
 using boost::system::error_code;
 using boost::filesystem::initial_path;
 using boost::filesystem::remove;
-using boost::lexical_cast;
+using boost::filesystem::unique_path;
+using boost::filesystem::is_regular_file;
+using boost::filesystem::absolute;
 
 namespace
 {
+#if BOOST_OS_WINDOWS != 0
+const char g_pathSeparator = ';';
+const char* const g_binExtension = ".exe";
+#else
+const char g_pathSeparator = ':';
+const char* const g_binExtension = "";
+#endif
+
+bool IsExecutableFile(const path &filePath)
+{
+    error_code errorCode;
+    if(false == is_regular_file(filePath, errorCode))
+    {
+        return false;
+    }
+#if BOOST_OS_WINDOWS == 0
+    return 0 == access(filePath.string().c_str(), X_OK);
+#else
+    return true;
+#endif
+}
+
+bool FindInDirectory(const path &directory, const string &commandName, string *binPath)
+{
+    path candidate(directory/commandName);
+    if(false == IsExecutableFile(candidate))
+    {
+        candidate = directory/(commandName+g_binExtension);
+        if(false == IsExecutableFile(candidate))
+        {
+            return false;
+        }
+    }
+    *binPath = absolute(candidate).string();
+    return true;
+}
+
+#if BOOST_OS_WINDOWS != 0
 void AddDoubleQuotation(string *cmd)
 {
     if(cmd->empty())
@@ -63,6 +113,9 @@ void ConcatenateCommand(const std::string &binPath, const vector<string> &param,
     }
 }
 
+// where AutoBatFile writes, see SetScriptDirectory
+path g_scriptDirectory;
+
 class AutoBatFile
 {
 public:
@@ -70,18 +123,25 @@ public:
     {
         try
         {
-            // seed the random generator
-            std::default_random_engine generator(time(nullptr));
-            std::uniform_int_distribution<int> dis(0,INT_MAX);
-            error_code errorCode;
+            // several workers may create their scripts in the same second,
+            // so the name comes from unique_path (it draws from the system
+            // random source) and the file is created exclusively ("x"),
+            // a name that is already taken is simply drawn again
             // for now, I just test it in Windows system
             // so the extension name only be ".bat"
             // but in the future I will adapt to other system like Linux(.sh)
-            m_autoGeneratedFile = (initial_path(errorCode)/
-                                   (lexical_cast<string>(dis(generator))+".bat"));
-            FILE *batFile = fopen(m_autoGeneratedFile.string().c_str(), "wb");
+            error_code errorCode;
+            FILE *batFile = nullptr;
+            for(int attempt = 0; nullptr == batFile && attempt < 16; ++attempt)
+            {
+                m_autoGeneratedFile = (g_scriptDirectory.empty() ? initial_path(errorCode) :
+                                       g_scriptDirectory)/
+                                      unique_path("%%%%-%%%%-%%%%-%%%%.bat", errorCode);
+                batFile = fopen(m_autoGeneratedFile.string().c_str(), "wbx");
+            }
             if(nullptr == batFile)
             {
+                m_autoGeneratedFile.clear();
                 return;
             }
             if(false == binDirectory.empty())
@@ -99,6 +159,10 @@ public:
     }
     ~AutoBatFile()
     {
+        if(m_autoGeneratedFile.empty())
+        {
+            return;
+        }
         error_code errorCode;
         remove(m_autoGeneratedFile, errorCode);
     }
@@ -110,9 +174,225 @@ public:
 private:
     path m_autoGeneratedFile;
 };
+#else
+// the children of SpawnWithOutputPipe that are not reaped yet
+struct SpawnedChildren
+{
+    std::mutex mutex;
+    std::set<pid_t> pids;
+};
+
+// never destroyed, the signal watcher may use it while the process exits
+SpawnedChildren& GetSpawnedChildren()
+{
+    static SpawnedChildren *spawnedChildren = new SpawnedChildren;
+    return *spawnedChildren;
+}
+
+void WaitChild(pid_t pid)
+{
+    int status = 0;
+    WaitSpawnedChild(pid, &status, 0);
+}
+#endif
 
 }
 
+void SetScriptDirectory(const string &scriptDirectory)
+{
+#if BOOST_OS_WINDOWS != 0
+    g_scriptDirectory = scriptDirectory;
+#else
+    // no script here, the processes are spawned directly
+    (void)scriptDirectory;
+#endif
+}
+
+bool ResolveBinaryPath(const string &binDirectory, const string &commandName,
+                       string *binPath)
+{
+    binPath->clear();
+    if(commandName.empty())
+    {
+        return false;
+    }
+    if(path(commandName).has_parent_path())
+    {
+        // already a path, do not search
+        if(false == IsExecutableFile(commandName))
+        {
+            return false;
+        }
+        *binPath = absolute(path(commandName)).string();
+        return true;
+    }
+    if(false == binDirectory.empty() && FindInDirectory(binDirectory, commandName, binPath))
+    {
+        return true;
+    }
+    const char* const envPath = getenv("PATH");
+    if(nullptr == envPath)
+    {
+        return false;
+    }
+    const char *begin = envPath;
+    while(true)
+    {
+        const char *end = strchr(begin, g_pathSeparator);
+        if(nullptr == end)
+        {
+            end = begin+strlen(begin);
+        }
+        // an empty entry means the current directory
+        const path directory(begin == end ? string(".") : string(begin, end));
+        if(FindInDirectory(directory, commandName, binPath))
+        {
+            return true;
+        }
+        if('\0' == *end)
+        {
+            return false;
+        }
+        begin = end+1;
+    }
+}
+
+#if BOOST_OS_WINDOWS == 0
+bool SpawnWithOutputPipe(const string &binPath, const vector<string> &param,
+                         const vector<std::pair<int, int>> &childFds,
+                         pid_t *pid, int *outputFd)
+{
+    int pipeFds[2];
+#if BOOST_OS_LINUX != 0
+    // close-on-exec from the start, the other workers spawn at the same time
+    // and must not inherit the write end (the read would never see EOF)
+    if(0 != pipe2(pipeFds, O_CLOEXEC))
+    {
+        return false;
+    }
+#else
+    if(0 != pipe(pipeFds))
+    {
+        return false;
+    }
+    fcntl(pipeFds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pipeFds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    vector<char*> argv;
+    argv.reserve(param.size()+2);
+    argv.push_back(const_cast<char*>(binPath.c_str()));
+    for(const auto &par : param)
+    {
+        argv.push_back(const_cast<char*>(par.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    // dup2 clears close-on-exec on the child's stdout
+    posix_spawn_file_actions_adddup2(&fileActions, pipeFds[1], STDOUT_FILENO);
+    // the sources are first copied above every target, so one dup2
+    // cannot overwrite the source of the next one in the child
+    int firstFreeFd = STDERR_FILENO+1;
+    for(const auto &childFd : childFds)
+    {
+        firstFreeFd = std::max(firstFreeFd, childFd.second+1);
+    }
+    vector<int> sourceFds;
+    sourceFds.reserve(childFds.size());
+    for(const auto &childFd : childFds)
+    {
+        const int sourceFd = fcntl(childFd.first, F_DUPFD_CLOEXEC, firstFreeFd);
+        if(-1 != sourceFd)
+        {
+            sourceFds.push_back(sourceFd);
+            posix_spawn_file_actions_adddup2(&fileActions, sourceFd, childFd.second);
+        }
+    }
+    // this process may block the exit signals for ScratchDirectory::RemoveOnSignal,
+    // the child starts with none blocked and dies on Ctrl-C with us
+    posix_spawnattr_t spawnAttributes;
+    posix_spawnattr_init(&spawnAttributes);
+    sigset_t emptySignals;
+    sigemptyset(&emptySignals);
+    posix_spawnattr_setsigmask(&spawnAttributes, &emptySignals);
+    posix_spawnattr_setflags(&spawnAttributes, POSIX_SPAWN_SETSIGMASK);
+    int spawnError = EMFILE;
+    if(sourceFds.size() == childFds.size())
+    {
+        // spawned and recorded at once, KillSpawnedChildren cannot miss it
+        SpawnedChildren &spawnedChildren = GetSpawnedChildren();
+        std::lock_guard<std::mutex> lock(spawnedChildren.mutex);
+        spawnError = posix_spawn(pid, binPath.c_str(), &fileActions, &spawnAttributes,
+                                 argv.data(), environ);
+        if(0 == spawnError)
+        {
+            spawnedChildren.pids.insert(*pid);
+        }
+    }
+    posix_spawnattr_destroy(&spawnAttributes);
+    posix_spawn_file_actions_destroy(&fileActions);
+    for(const int sourceFd : sourceFds)
+    {
+        close(sourceFd);
+    }
+    close(pipeFds[1]);
+    if(0 != spawnError)
+    {
+        close(pipeFds[0]);
+        return false;
+    }
+    *outputFd = pipeFds[0];
+    return true;
+}
+
+pid_t WaitSpawnedChild(pid_t pid, int *status, int options)
+{
+    SpawnedChildren &spawnedChildren = GetSpawnedChildren();
+    if(0 == (options & WNOHANG))
+    {
+        // no lock while blocked, the child is forgotten first
+        {
+            std::lock_guard<std::mutex> lock(spawnedChildren.mutex);
+            spawnedChildren.pids.erase(pid);
+        }
+        pid_t waited = -1;
+        while(-1 == (waited = waitpid(pid, status, options)) && EINTR == errno)
+        {}
+        return waited;
+    }
+    // reaped and forgotten at once, so its pid is never signalled once reused
+    std::lock_guard<std::mutex> lock(spawnedChildren.mutex);
+    pid_t waited = -1;
+    while(-1 == (waited = waitpid(pid, status, options)) && EINTR == errno)
+    {}
+    if(0 != waited)
+    {
+        spawnedChildren.pids.erase(pid);
+    }
+    return waited;
+}
+
+void KillSpawnedChildren()
+{
+    SpawnedChildren &spawnedChildren = GetSpawnedChildren();
+    // never unlocked: the process is about to exit, any spawn or wait blocks
+    // from now on, so no caller takes the end of a killed child for its result
+    spawnedChildren.mutex.lock();
+    for(const pid_t pid : spawnedChildren.pids)
+    {
+        kill(pid, SIGKILL);
+    }
+    for(const pid_t pid : spawnedChildren.pids)
+    {
+        int status = 0;
+        while(-1 == waitpid(pid, &status, 0) && EINTR == errno)
+        {}
+    }
+}
+#endif
+
+#if BOOST_OS_WINDOWS != 0
 void ProcessInvoke(const string &binDirectory, const string &commandName,
                    const vector<string> &param, function<void(const char*)> cmdCallback)
 {
@@ -131,6 +411,10 @@ void ProcessInvoke(const string &binDirectory, const string &commandName,
     string batFilePath;
     autoBatFile.GetBatFilePath(&batFilePath);
     FILE *stream = popen(batFilePath.c_str(), "r");
+    if(nullptr == stream)
+    {
+        return;
+    }
     char buffer[2048];
     while(fgets(buffer, sizeof(buffer), stream))
     {
@@ -138,4 +422,35 @@ void ProcessInvoke(const string &binDirectory, const string &commandName,
     }
     pclose(stream);
 }
-
+#else
+void ProcessInvoke(const string &binDirectory, const string &commandName,
+                   const vector<string> &param, function<void(const char*)> cmdCallback)
+{
+    string binPath(commandName);
+    if(false == path(commandName).is_absolute() &&
+       false == ResolveBinaryPath(binDirectory, commandName, &binPath))
+    {
+        return;
+    }
+    pid_t pid = 0;
+    int outputFd = -1;
+    if(false == SpawnWithOutputPipe(binPath, param, {}, &pid, &outputFd))
+    {
+        return;
+    }
+    FILE *stream = fdopen(outputFd, "r");
+    if(nullptr == stream)
+    {
+        close(outputFd);
+        WaitChild(pid);
+        return;
+    }
+    char buffer[2048];
+    while(fgets(buffer, sizeof(buffer), stream))
+    {
+        cmdCallback(buffer);
+    }
+    fclose(stream);
+    WaitChild(pid);
+}
+#endif
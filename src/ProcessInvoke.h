@@ -13,11 +13,51 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <utility>
 
+#include <boost/predef/os.h>
+#if BOOST_OS_WINDOWS == 0
+#include <sys/types.h>
+#endif
 
+// look for commandName in binDirectory first, then in the directories of PATH
+// binPath receives the absolute path of the executable
+// resolve once and hand the result to ProcessInvoke, so no call searches again
+bool ResolveBinaryPath(const std::string &binDirectory,
+                       const std::string &commandName,
+                       std::string *binPath);
+
+// where the scripts of ProcessInvoke are written (Windows), the current
+// directory by default, set it before the first ProcessInvoke
+void SetScriptDirectory(const std::string &scriptDirectory);
+
+// run commandName with param, every line of its standard output goes to cmdCallback
+// on Linux and Mac OS the process is spawned directly (no script, no shell),
+// when commandName is not a path it is resolved with ResolveBinaryPath first
 void ProcessInvoke(const std::string &binDirectory,
                    const std::string &commandName,
                    const std::vector<std::string> &param,
                    std::function<void(const char*)> cmdCallback);
 
+#if BOOST_OS_WINDOWS == 0
+// start binPath with param without waiting for it
+// the read end of its standard output pipe goes to *outputFd (close-on-exec),
+// the caller reads it and reaps *pid
+// every {parent fd, child fd} of childFds is open in the child under the
+// child number; the pipe and the copies made for childFds are close-on-exec,
+// any other descriptor of this process is inherited unless it has FD_CLOEXEC
+bool SpawnWithOutputPipe(const std::string &binPath,
+                         const std::vector<std::string> &param,
+                         const std::vector<std::pair<int, int>> &childFds,
+                         pid_t *pid, int *outputFd);
+
+// waitpid(pid, status, options) for a child of SpawnWithOutputPipe, again on EINTR
+// every child must be reaped with it, KillSpawnedChildren leaves the reaped ones alone
+pid_t WaitSpawnedChild(pid_t pid, int *status, int options);
+
+// SIGKILL every child of SpawnWithOutputPipe that is not reaped yet, then reap it
+// for a process about to exit: SpawnWithOutputPipe and WaitSpawnedChild block from then on
+void KillSpawnedChildren();
+#endif
+
 #endif // COMMON_PROCESSINVOKE_H_
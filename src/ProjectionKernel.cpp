@@ -0,0 +1,101 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the function: FindGroundPointsInImage
+// and its scalar kernel
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProjectionKernel.h"
+#include "ProjectionKernelImpl.h"
+
+namespace
+{
+struct ScalarOps
+{
+    typedef float Vec;
+    typedef bool Mask;
+    static constexpr size_t width = 1;
+
+    static Vec Set(float value) {return value;}
+    static Vec Load(const float *values) {return *values;}
+    static Vec Add(Vec a, Vec b) {return a+b;}
+    static Vec Sub(Vec a, Vec b) {return a-b;}
+    static Vec Mul(Vec a, Vec b) {return a*b;}
+    static Vec Div(Vec a, Vec b) {return a/b;}
+    static Mask Greater(Vec a, Vec b) {return a > b;}
+    static Mask LessEqual(Vec a, Vec b) {return a <= b;}
+    static Mask And(Mask a, Mask b) {return a && b;}
+    static Mask Tail(size_t) {return true;}
+    static size_t Compact(Mask inside, uint32_t firstIndex, uint32_t *insideIndices)
+    {
+        *insideIndices = firstIndex;
+        return inside ? 1 : 0;
+    }
+};
+
+typedef size_t (*KernelFunc)(const CameraConstants&, const GroundPointColumns&, uint32_t*);
+
+KernelFunc SelectKernel()
+{
+#ifdef GCP2IMGS_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+    {
+        return FindGroundPointsInImageAvx512;
+    }
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return FindGroundPointsInImageAvx2;
+    }
+#endif
+    return FindGroundPointsInImageScalar;
+}
+}
+
+void BuildGroundPointTable(const double *ground, size_t count, GroundPointTable *table)
+{
+    double *origin = table->origin;
+    origin[0] = origin[1] = origin[2] = 0.0;
+    for(size_t index = 0; count != index; ++index)
+    {
+        origin[0] += ground[3*index];
+        origin[1] += ground[3*index+1];
+        origin[2] += ground[3*index+2];
+    }
+    if(0 != count)
+    {
+        origin[0] /= count;
+        origin[1] /= count;
+        origin[2] /= count;
+    }
+    const size_t paddedCount = (count+g_groundPointBlock-1)/g_groundPointBlock*g_groundPointBlock;
+    table->count = count;
+    table->x.assign(paddedCount, 0.0f);
+    table->y.assign(paddedCount, 0.0f);
+    table->z.assign(paddedCount, 0.0f);
+    for(size_t index = 0; count != index; ++index, ground += 3)
+    {
+        table->x[index] = static_cast<float>(ground[0]-origin[0]);
+        table->y[index] = static_cast<float>(ground[1]-origin[1]);
+        table->z[index] = static_cast<float>(ground[2]-origin[2]);
+    }
+}
+
+size_t FindGroundPointsInImageScalar(const CameraConstants &camera,
+                                     const GroundPointColumns &columns,
+                                     uint32_t *insideIndices)
+{
+    return FindInsideWith<ScalarOps>(camera, columns, insideIndices);
+}
+
+size_t FindGroundPointsInImage(const CameraConstants &camera,
+                               const GroundPointTable &table,
+                               uint32_t *insideIndices)
+{
+    static const KernelFunc kernel = SelectKernel();
+    const GroundPointColumns columns = {table.x.data(), table.y.data(), table.z.data(), table.count};
+    return kernel(camera, columns, insideIndices);
+}
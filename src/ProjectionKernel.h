@@ -0,0 +1,84 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the function: FindGroundPointsInImage
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_PROJECTIONKERNEL_H_
+#define COMMON_PROJECTIONKERNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the widest kernel handles this many points per step,
+// the columns are padded to a multiple of it
+constexpr size_t g_groundPointBlock = 16;
+
+// ground points as float columns (structure of arrays), relative to origin
+// so that float keeps millimetres over a whole block
+struct GroundPointTable
+{
+    double origin[3];
+    std::vector<float> x, y, z;
+    // number of real points, the columns hold zeros after it
+    size_t count;
+};
+
+// ground holds count x y z triplets
+void BuildGroundPointTable(const double *ground, size_t count, GroundPointTable *table);
+
+// the columns of a GroundPointTable as plain pointers, what the kernels take:
+// the kernel sources are built with their own instruction set and must not
+// instantiate std::vector members the rest of the program shares
+struct GroundPointColumns
+{
+    const float *x, *y, *z;
+    size_t count;
+};
+
+// one camera, in float and relative to the origin of the table
+// camera = rotation*ground+translation
+// focal = principalPoint+focal*camera.xy/camera.z, then distortion,
+// image = i00+v10*focal.x+v01*focal.y, inside when it falls in [0,width]x[0,height]
+struct CameraConstants
+{
+    // 0: none, 1: radial, 2: photogrammetric standard (see DistortionModel)
+    int distortionModel;
+    float rotation[9];
+    float translation[3];
+    float focal;
+    float principalPoint[2];
+    float distortionCentre[2];
+    float radialCoeffs[8];
+    size_t radialCoeffCount;
+    float p1, p2, b1, b2;
+    float i00[2], v10[2], v01[2];
+    float width, height;
+};
+
+// write the indices of the points inside the image to insideIndices
+// (it must hold table.x.size() entries), returns their count
+// the widest kernel the CPU supports is chosen at run time,
+// every kernel gives the same result as the scalar one
+size_t FindGroundPointsInImage(const CameraConstants &camera,
+                               const GroundPointTable &table,
+                               uint32_t *insideIndices);
+
+// the kernels behind FindGroundPointsInImage
+size_t FindGroundPointsInImageScalar(const CameraConstants &camera,
+                                     const GroundPointColumns &columns,
+                                     uint32_t *insideIndices);
+#ifdef GCP2IMGS_X86_KERNELS
+size_t FindGroundPointsInImageAvx2(const CameraConstants &camera,
+                                   const GroundPointColumns &columns,
+                                   uint32_t *insideIndices);
+size_t FindGroundPointsInImageAvx512(const CameraConstants &camera,
+                                     const GroundPointColumns &columns,
+                                     uint32_t *insideIndices);
+#endif
+
+#endif // COMMON_PROJECTIONKERNEL_H_
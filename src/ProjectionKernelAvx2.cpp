@@ -0,0 +1,95 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the AVX2 kernel of:
+// FindGroundPointsInImage, it is built with -mavx2
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProjectionKernel.h"
+#include "ProjectionKernelImpl.h"
+
+#include <immintrin.h>
+
+namespace
+{
+// lane of the n-th set bit of a 8 bit mask, 0 when it has fewer bits
+constexpr uint32_t NthSetBit(int mask, int n, int bit = 0)
+{
+    return 8 == bit ? 0 :
+           0 == (mask & (1 << bit)) ? NthSetBit(mask, n, bit+1) :
+           0 == n ? static_cast<uint32_t>(bit) : NthSetBit(mask, n-1, bit+1);
+}
+
+// lane permutation that moves the selected lanes of the mask to the front,
+// one 4 bit lane index per nibble
+constexpr uint32_t PackedPermutation(int mask, int lane = 0)
+{
+    return 8 == lane ? 0 : (NthSetBit(mask, lane) << (4*lane)) | PackedPermutation(mask, lane+1);
+}
+
+// static data, so this unit has no constructor to run before the CPU is checked
+#define COMPACT_ROW4(mask) PackedPermutation(mask), PackedPermutation((mask)+1), \
+                           PackedPermutation((mask)+2), PackedPermutation((mask)+3)
+#define COMPACT_ROW16(mask) COMPACT_ROW4(mask), COMPACT_ROW4((mask)+4), \
+                            COMPACT_ROW4((mask)+8), COMPACT_ROW4((mask)+12)
+#define COMPACT_ROW64(mask) COMPACT_ROW16(mask), COMPACT_ROW16((mask)+16), \
+                            COMPACT_ROW16((mask)+32), COMPACT_ROW16((mask)+48)
+constexpr uint32_t g_compactTable[256] =
+{
+    COMPACT_ROW64(0), COMPACT_ROW64(64), COMPACT_ROW64(128), COMPACT_ROW64(192)
+};
+#undef COMPACT_ROW64
+#undef COMPACT_ROW16
+#undef COMPACT_ROW4
+
+struct Avx2Ops
+{
+    typedef __m256 Vec;
+    typedef __m256 Mask;
+    static constexpr size_t width = 8;
+
+    static Vec Set(float value) {return _mm256_set1_ps(value);}
+    static Vec Load(const float *values) {return _mm256_loadu_ps(values);}
+    static Vec Add(Vec a, Vec b) {return _mm256_add_ps(a, b);}
+    static Vec Sub(Vec a, Vec b) {return _mm256_sub_ps(a, b);}
+    static Vec Mul(Vec a, Vec b) {return _mm256_mul_ps(a, b);}
+    static Vec Div(Vec a, Vec b) {return _mm256_div_ps(a, b);}
+    static Mask Greater(Vec a, Vec b) {return _mm256_cmp_ps(a, b, _CMP_GT_OQ);}
+    static Mask LessEqual(Vec a, Vec b) {return _mm256_cmp_ps(a, b, _CMP_LE_OQ);}
+    static Mask And(Mask a, Mask b) {return _mm256_and_ps(a, b);}
+    static Mask Tail(size_t remaining)
+    {
+        if(remaining >= width)
+        {
+            return _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        }
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(remaining)),
+                                                      lanes));
+    }
+    static size_t Compact(Mask inside, uint32_t firstIndex, uint32_t *insideIndices)
+    {
+        const int mask = _mm256_movemask_ps(inside);
+        const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(firstIndex)),
+                                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256i permutation = _mm256_and_si256(
+            _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(g_compactTable[mask])),
+                              _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28)),
+            _mm256_set1_epi32(0xF));
+        // the whole vector is stored, the caller's buffer has room for it
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(insideIndices),
+                            _mm256_permutevar8x32_epi32(indices, permutation));
+        return static_cast<size_t>(__builtin_popcount(mask));
+    }
+};
+}
+
+size_t FindGroundPointsInImageAvx2(const CameraConstants &camera,
+                                   const GroundPointColumns &columns,
+                                   uint32_t *insideIndices)
+{
+    return FindInsideWith<Avx2Ops>(camera, columns, insideIndices);
+}
@@ -0,0 +1,54 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the AVX-512 kernel of:
+// FindGroundPointsInImage, it is built with -mavx512f
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProjectionKernel.h"
+#include "ProjectionKernelImpl.h"
+
+#include <immintrin.h>
+
+namespace
+{
+struct Avx512Ops
+{
+    typedef __m512 Vec;
+    typedef __mmask16 Mask;
+    static constexpr size_t width = 16;
+
+    static Vec Set(float value) {return _mm512_set1_ps(value);}
+    static Vec Load(const float *values) {return _mm512_loadu_ps(values);}
+    static Vec Add(Vec a, Vec b) {return _mm512_add_ps(a, b);}
+    static Vec Sub(Vec a, Vec b) {return _mm512_sub_ps(a, b);}
+    static Vec Mul(Vec a, Vec b) {return _mm512_mul_ps(a, b);}
+    static Vec Div(Vec a, Vec b) {return _mm512_div_ps(a, b);}
+    static Mask Greater(Vec a, Vec b) {return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);}
+    static Mask LessEqual(Vec a, Vec b) {return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);}
+    static Mask And(Mask a, Mask b) {return static_cast<Mask>(a & b);}
+    static Mask Tail(size_t remaining)
+    {
+        return remaining >= width ? static_cast<Mask>(0xFFFF) :
+                                    static_cast<Mask>((1u << remaining)-1);
+    }
+    static size_t Compact(Mask inside, uint32_t firstIndex, uint32_t *insideIndices)
+    {
+        const __m512i indices = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(firstIndex)),
+                                                 _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                                                   8, 9, 10, 11, 12, 13, 14, 15));
+        _mm512_mask_compressstoreu_epi32(insideIndices, inside, indices);
+        return static_cast<size_t>(__builtin_popcount(inside));
+    }
+};
+}
+
+size_t FindGroundPointsInImageAvx512(const CameraConstants &camera,
+                                     const GroundPointColumns &columns,
+                                     uint32_t *insideIndices)
+{
+    return FindInsideWith<Avx512Ops>(camera, columns, insideIndices);
+}
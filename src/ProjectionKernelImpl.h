@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and 
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that implements the template: FindInsideWith
+// Each kernel source includes it with its own instruction set, so everything
+// here stays in an unnamed namespace (one copy per compile unit)
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_PROJECTIONKERNELIMPL_H_
+#define COMMON_PROJECTIONKERNELIMPL_H_
+
+#include "ProjectionKernel.h"
+
+namespace
+{
+// Ops gives the vector type (Vec), the lane mask type (Mask), the lane count
+// (width) and the few operations the projection needs.
+// Every lane does exactly the float operations of the scalar kernel in the
+// same order (the kernel sources are built without contraction into FMA),
+// so the result does not depend on the instruction set.
+template<class Ops, int Model>
+size_t FindInsideKernel(const CameraConstants &camera, const GroundPointColumns &columns,
+                        uint32_t *insideIndices)
+{
+    typedef typename Ops::Vec Vec;
+    typedef typename Ops::Mask Mask;
+    const Vec r0 = Ops::Set(camera.rotation[0]), r1 = Ops::Set(camera.rotation[1]),
+              r2 = Ops::Set(camera.rotation[2]), r3 = Ops::Set(camera.rotation[3]),
+              r4 = Ops::Set(camera.rotation[4]), r5 = Ops::Set(camera.rotation[5]),
+              r6 = Ops::Set(camera.rotation[6]), r7 = Ops::Set(camera.rotation[7]),
+              r8 = Ops::Set(camera.rotation[8]);
+    const Vec t0 = Ops::Set(camera.translation[0]), t1 = Ops::Set(camera.translation[1]),
+              t2 = Ops::Set(camera.translation[2]);
+    const Vec focal = Ops::Set(camera.focal);
+    const Vec ppX = Ops::Set(camera.principalPoint[0]), ppY = Ops::Set(camera.principalPoint[1]);
+    const Vec cdX = Ops::Set(camera.distortionCentre[0]), cdY = Ops::Set(camera.distortionCentre[1]);
+    const Vec p1 = Ops::Set(camera.p1), p2 = Ops::Set(camera.p2);
+    const Vec b1 = Ops::Set(camera.b1), b2 = Ops::Set(camera.b2);
+    const Vec two = Ops::Set(2.0f);
+    const Vec i00X = Ops::Set(camera.i00[0]), i00Y = Ops::Set(camera.i00[1]);
+    const Vec v10X = Ops::Set(camera.v10[0]), v10Y = Ops::Set(camera.v10[1]);
+    const Vec v01X = Ops::Set(camera.v01[0]), v01Y = Ops::Set(camera.v01[1]);
+    const Vec zero = Ops::Set(0.0f);
+    const Vec width = Ops::Set(camera.width), height = Ops::Set(camera.height);
+
+    const float *xs = columns.x, *ys = columns.y, *zs = columns.z;
+    size_t insideCount = 0;
+    for(size_t index = 0; index < columns.count; index += Ops::width)
+    {
+        const Vec x = Ops::Load(xs+index), y = Ops::Load(ys+index), z = Ops::Load(zs+index);
+        const Vec cameraZ = Ops::Add(Ops::Add(Ops::Add(Ops::Mul(r6, x), Ops::Mul(r7, y)),
+                                              Ops::Mul(r8, z)), t2);
+        const Vec cameraX = Ops::Add(Ops::Add(Ops::Add(Ops::Mul(r0, x), Ops::Mul(r1, y)),
+                                              Ops::Mul(r2, z)), t0);
+        const Vec cameraY = Ops::Add(Ops::Add(Ops::Add(Ops::Mul(r3, x), Ops::Mul(r4, y)),
+                                              Ops::Mul(r5, z)), t1);
+        // lanes behind the camera divide by <= 0, they are masked below
+        Vec focalX = Ops::Add(ppX, Ops::Mul(focal, Ops::Div(cameraX, cameraZ)));
+        Vec focalY = Ops::Add(ppY, Ops::Mul(focal, Ops::Div(cameraY, cameraZ)));
+        if(0 != Model)
+        {
+            const Vec dx = Ops::Sub(focalX, cdX), dy = Ops::Sub(focalY, cdY);
+            const Vec dx2 = Ops::Mul(dx, dx), dy2 = Ops::Mul(dy, dy);
+            const Vec r2Dist = Ops::Add(dx2, dy2);
+            // odd radial polynomial by Horner
+            Vec factor = zero;
+            for(size_t coeff = camera.radialCoeffCount; 0 != coeff; --coeff)
+            {
+                factor = Ops::Mul(Ops::Add(factor, Ops::Set(camera.radialCoeffs[coeff-1])), r2Dist);
+            }
+            Vec shiftX = Ops::Mul(dx, factor), shiftY = Ops::Mul(dy, factor);
+            if(2 == Model)
+            {
+                const Vec dxy = Ops::Mul(dx, dy);
+                shiftX = Ops::Add(shiftX, Ops::Add(Ops::Add(Ops::Add(
+                             Ops::Mul(Ops::Add(Ops::Mul(two, dx2), r2Dist), p1),
+                             Ops::Mul(Ops::Mul(two, dxy), p2)),
+                             Ops::Mul(b1, dx)), Ops::Mul(b2, dy)));
+                shiftY = Ops::Add(shiftY, Ops::Add(
+                             Ops::Mul(Ops::Mul(two, dxy), p1),
+                             Ops::Mul(Ops::Add(Ops::Mul(two, dy2), r2Dist), p2)));
+            }
+            focalX = Ops::Add(focalX, shiftX);
+            focalY = Ops::Add(focalY, shiftY);
+        }
+        const Vec imageX = Ops::Add(Ops::Add(i00X, Ops::Mul(v10X, focalX)), Ops::Mul(v01X, focalY));
+        const Vec imageY = Ops::Add(Ops::Add(i00Y, Ops::Mul(v10Y, focalX)), Ops::Mul(v01Y, focalY));
+        Mask inside = Ops::And(Ops::Greater(cameraZ, zero), Ops::Tail(columns.count-index));
+        inside = Ops::And(inside, Ops::And(Ops::LessEqual(zero, imageX), Ops::LessEqual(imageX, width)));
+        inside = Ops::And(inside, Ops::And(Ops::LessEqual(zero, imageY), Ops::LessEqual(imageY, height)));
+        insideCount += Ops::Compact(inside, static_cast<uint32_t>(index), insideIndices+insideCount);
+    }
+    return insideCount;
+}
+
+// the distortion model is chosen once per camera
+template<class Ops>
+size_t FindInsideWith(const CameraConstants &camera, const GroundPointColumns &columns,
+                      uint32_t *insideIndices)
+{
+    switch(camera.distortionModel)
+    {
+    case 1:
+        return FindInsideKernel<Ops, 1>(camera, columns, insideIndices);
+    case 2:
+        return FindInsideKernel<Ops, 2>(camera, columns, insideIndices);
+    default:
+        return FindInsideKernel<Ops, 0>(camera, columns, insideIndices);
+    }
+}
+}
+
+#endif // COMMON_PROJECTIONKERNELIMPL_H_
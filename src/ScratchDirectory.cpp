@@ -0,0 +1,216 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the source file that implements the classes: ScratchDirectory and MemoryFile
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include "ScratchDirectory.h"
+#include "ProcessInvoke.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include <boost/predef/os.h>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+#if BOOST_OS_WINDOWS == 0
+#include <csignal>
+#include <thread>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+#if BOOST_OS_LINUX != 0
+#include <sys/mman.h>
+#endif
+
+using std::string;
+using std::vector;
+
+using boost::filesystem::path;
+using boost::system::error_code;
+
+namespace
+{
+#if BOOST_OS_LINUX != 0
+const char* const g_tmpfsDirectory = "/dev/shm";
+#endif
+const char* const g_scratchPrefix = "GCP2Imgs-";
+
+// a new directory in parentPath that no other run can take
+bool MakeUniqueDirectory(const path &parentPath, string *directoryPath)
+{
+#if BOOST_OS_WINDOWS == 0
+    // mode 0700 and a name nobody else can take
+    string pattern((parentPath/g_scratchPrefix).string());
+    pattern.append("XXXXXX");
+    vector<char> directoryName(pattern.begin(), pattern.end());
+    directoryName.push_back('\0');
+    if(nullptr == mkdtemp(directoryName.data()))
+    {
+        return false;
+    }
+    *directoryPath = directoryName.data();
+    return true;
+#else
+    error_code errorCode;
+    for(int attempt = 0; attempt < 16; ++attempt)
+    {
+        const path candidate = parentPath/boost::filesystem::unique_path(
+            string(g_scratchPrefix)+"%%%%-%%%%-%%%%", errorCode);
+        if(boost::filesystem::create_directory(candidate, errorCode))
+        {
+            *directoryPath = candidate.string();
+            return true;
+        }
+    }
+    return false;
+#endif
+}
+
+#if BOOST_OS_WINDOWS == 0
+// the signals that end the run from the terminal or a job scheduler
+void FillExitSignals(sigset_t *signals)
+{
+    sigemptyset(signals);
+    sigaddset(signals, SIGINT);
+    sigaddset(signals, SIGTERM);
+    sigaddset(signals, SIGHUP);
+}
+#endif
+}
+
+ScratchDirectory::ScratchDirectory()
+{}
+
+ScratchDirectory::~ScratchDirectory()
+{
+    if(false == m_path.empty())
+    {
+        error_code errorCode;
+        boost::filesystem::remove_all(path(m_path), errorCode);
+    }
+}
+
+bool ScratchDirectory::Create(const string &parentDirectory)
+{
+    if(false == parentDirectory.empty())
+    {
+        return MakeUniqueDirectory(path(parentDirectory), &m_path);
+    }
+    // tmpfs first, the files never reach a disk or a network file system
+    vector<path> candidates;
+    const char *runtimeDirectory = getenv("XDG_RUNTIME_DIR");
+    if(nullptr != runtimeDirectory && '\0' != runtimeDirectory[0])
+    {
+        candidates.push_back(path(runtimeDirectory));
+    }
+#if BOOST_OS_LINUX != 0
+    candidates.push_back(path(g_tmpfsDirectory));
+#endif
+    error_code errorCode;
+    const path tempDirectory = boost::filesystem::temp_directory_path(errorCode);
+    if(false == static_cast<bool>(errorCode))
+    {
+        candidates.push_back(tempDirectory);
+    }
+    for(const path &candidate : candidates)
+    {
+        if(MakeUniqueDirectory(candidate, &m_path))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScratchDirectory::RemoveOnSignal()
+{
+#if BOOST_OS_WINDOWS == 0
+    if(m_path.empty())
+    {
+        return;
+    }
+    // the threads started from now on inherit the mask,
+    // so only the watcher receives the signals
+    sigset_t signals;
+    FillExitSignals(&signals);
+    if(0 != pthread_sigmask(SIG_BLOCK, &signals, nullptr))
+    {
+        return;
+    }
+    // the watcher owns its copy of the path, it is never joined
+    // and may outlive this object until the process exits
+    const string directoryPath(m_path);
+    std::thread([directoryPath]()
+    {
+        sigset_t exitSignals;
+        FillExitSignals(&exitSignals);
+        int signalNumber = 0;
+        while(0 != sigwait(&exitSignals, &signalNumber))
+        {}
+        // the children write into the directory, they go first
+        KillSpawnedChildren();
+        error_code errorCode;
+        boost::filesystem::remove_all(path(directoryPath), errorCode);
+        // the status a shell expects from a process killed by the signal
+        _exit(128+signalNumber);
+    }).detach();
+#endif
+}
+
+const string& ScratchDirectory::Path() const
+{
+    return m_path;
+}
+
+MemoryFile::MemoryFile()
+    : m_fd(-1)
+{}
+
+MemoryFile::~MemoryFile()
+{
+#if BOOST_OS_LINUX != 0
+    if(-1 != m_fd)
+    {
+        close(m_fd);
+    }
+#endif
+}
+
+bool MemoryFile::Create(const char *name, const string &content)
+{
+#if BOOST_OS_LINUX != 0 && defined(MFD_CLOEXEC)
+    const int fd = memfd_create(name, MFD_CLOEXEC);
+    if(-1 == fd)
+    {
+        return false;
+    }
+    size_t written = 0;
+    while(content.size() != written)
+    {
+        const ssize_t byteWritten = write(fd, content.data()+written, content.size()-written);
+        if(byteWritten <= 0)
+        {
+            close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(byteWritten);
+    }
+    m_fd = fd;
+    return true;
+#else
+    (void)name;
+    (void)content;
+    return false;
+#endif
+}
+
+int MemoryFile::Fd() const
+{
+    return m_fd;
+}
@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015, Toro Lee. Use, modification and
+// distribution are subject to the CeCILL-B License
+// Author(s): Toro Lee <poy49295@163.com>
+// This is the header file that declare the classes: ScratchDirectory and MemoryFile
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMMON_SCRATCHDIRECTORY_H_
+#define COMMON_SCRATCHDIRECTORY_H_
+
+#include <string>
+
+// a private directory of this run for every temporary file,
+// on tmpfs when the system has one, removed with its content by the destructor
+class ScratchDirectory
+{
+public:
+    ScratchDirectory();
+    ~ScratchDirectory();
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    // make a new directory in parentDirectory, or when it is empty in the first
+    // of $XDG_RUNTIME_DIR, /dev/shm and the system temporary directory that allows it
+    bool Create(const std::string &parentDirectory);
+    // remove the directory when SIGINT, SIGTERM or SIGHUP ends the process
+    // call it before starting any thread, the signals are only taken by a watcher
+    // thread that kills and reaps the children of SpawnWithOutputPipe, removes the
+    // directory then exits, elsewhere than POSIX it does nothing
+    // the signals stay blocked in the calling thread and in every thread it starts
+    // later for the rest of the process, also once this object is gone
+    void RemoveOnSignal();
+    // empty before Create
+    const std::string& Path() const;
+
+private:
+    std::string m_path;
+};
+
+// an anonymous file in memory, a child that got the descriptor
+// opens it as /proc/self/fd/<n>, closed by the destructor
+class MemoryFile
+{
+public:
+    MemoryFile();
+    ~MemoryFile();
+
+    MemoryFile(const MemoryFile&) = delete;
+    MemoryFile& operator=(const MemoryFile&) = delete;
+
+    // false where memfd_create is missing (not Linux, old kernel)
+    bool Create(const char *name, const std::string &content);
+    // -1 before Create
+    int Fd() const;
+
+private:
+    int m_fd;
+};
+
+#endif // COMMON_SCRATCHDIRECTORY_H_